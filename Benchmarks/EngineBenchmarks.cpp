@@ -0,0 +1,381 @@
+// Microbenchmarks for the collision, drop, line clear and spawn paths of the engine.
+// Every benchmark runs on boards filled from 0 to 100 percent, built from a fixed seed so runs are comparable.
+// Board evaluation compares the vector kernels with the scalar fallback and a cell by cell loop.
+// The bot is measured up to half filled boards, fuller ones leave no room to spawn.
+// Rollouts run with a 1 ms budget per move on 1 to 8 workers, items are the rollouts played.
+// Transposition tables from 64 KB to 64 MB are probed with twice the keys stored, half of them never stored.
+// The 3D well benchmarks run on half filled wells from 4x4 to 8x8 columns, 20 layers high.
+
+#include "Bot.h"
+#include "Game.h"
+#include "Game3D.h"
+#include "Random.h"
+#include "RolloutSearch.h"
+#include "ThreadPool.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include <benchmark/benchmark.h>
+
+#define FIXTURE_SEED                0xB0A2D
+#define FIXTURE_POSITIONS           64
+
+// Fills every visible cell with the given probability, same seed gives the same board
+void FillBoard(Game& game, int64 percent, uint64 seed)
+{
+    Random random(seed);
+    for (int32 y = 0; y < MAX_HEIGHT; y++)
+        for (int32 x = 0; x < MAX_WIDTH; x++)
+            if (random.Next(100) < percent)
+                game.PlaceSubBlock(x, y, COLOR_GRAY);
+}
+
+void SetUpGame(Game& game, int64 percent)
+{
+    game.ResetGame(DEFAULT_LEVEL, FIXTURE_SEED);
+    game.StartGame();
+    FillBoard(game, percent, FIXTURE_SEED + uint64(percent));
+}
+
+// Active block origins spread over the whole board, free or not
+std::vector<Position> MakePositions()
+{
+    Random random(FIXTURE_SEED);
+    std::vector<Position> positions;
+    for (uint32 i = 0; i < FIXTURE_POSITIONS; i++)
+        positions.push_back(Position(int8(1 + random.Next(BOARD_WIDTH - 3)), int8(2 + random.Next(MAX_HEIGHT))));
+
+    return positions;
+}
+
+static void BM_GetSubBlockInPosition(benchmark::State& state)
+{
+    Game game;
+    SetUpGame(game, state.range(0));
+
+    for (auto _ : state)
+        for (int32 y = 0; y < MAX_HEIGHT; y++)
+            for (int32 x = 0; x < MAX_WIDTH; x++)
+                benchmark::DoNotOptimize(game.GetSubBlockInPosition(x, y));
+
+    state.SetItemsProcessed(state.iterations() * MAX_WIDTH * MAX_HEIGHT);
+}
+BENCHMARK(BM_GetSubBlockInPosition)->DenseRange(0, 100, 25);
+
+template <typename Query>
+static void RunBlockQuery(benchmark::State& state, Query query)
+{
+    Game game;
+    SetUpGame(game, state.range(0));
+    Block* block = game.GetActiveBlock();
+    std::vector<Position> positions = MakePositions();
+
+    uint32 i = 0;
+    for (auto _ : state)
+    {
+        const Position& position = positions[i++ % FIXTURE_POSITIONS];
+        block->SetPosition(position);
+        benchmark::DoNotOptimize(query(block));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_CanDropBlock(benchmark::State& state)
+{
+    RunBlockQuery(state, [](Block* block) { return block->CanDropBlock(); });
+}
+BENCHMARK(BM_CanDropBlock)->DenseRange(0, 100, 25);
+
+static void BM_CanMoveBlock(benchmark::State& state)
+{
+    RunBlockQuery(state, [](Block* block) { return block->CanMoveBlock(true) || block->CanMoveBlock(false); });
+}
+BENCHMARK(BM_CanMoveBlock)->DenseRange(0, 100, 25);
+
+static void BM_CanRotateBlock(benchmark::State& state)
+{
+    RunBlockQuery(state, [](Block* block) { return block->CanRotateBlock(); });
+}
+BENCHMARK(BM_CanRotateBlock)->DenseRange(0, 100, 25);
+
+static void BM_Drop(benchmark::State& state)
+{
+    // Drop from above the board, where the block always starts
+    Game game;
+    SetUpGame(game, state.range(0));
+    Block* block = game.GetActiveBlock();
+    Random random(FIXTURE_SEED);
+
+    for (auto _ : state)
+    {
+        block->SetPosition(Position(int8(1 + random.Next(BOARD_WIDTH - 3)), int8(MAX_HEIGHT)));
+        block->Drop();
+        benchmark::DoNotOptimize(block->GetPositionY());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Drop)->DenseRange(0, 100, 25);
+
+static void BM_CheckLineCompleted(benchmark::State& state)
+{
+    Game game;
+    for (auto _ : state)
+    {
+        // Clearing changes the board, so it is rebuilt out of the timed region
+        state.PauseTiming();
+        SetUpGame(game, state.range(0));
+        state.ResumeTiming();
+
+        game.CheckLineCompleted();
+        benchmark::DoNotOptimize(game.GetLastClearedRows());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CheckLineCompleted)->DenseRange(0, 100, 25);
+
+static void BM_GenerateBlock(benchmark::State& state)
+{
+    Game game;
+    SetUpGame(game, state.range(0));
+
+    for (auto _ : state)
+    {
+        game.ReleaseBlock(game.GetNextBlock());
+        benchmark::DoNotOptimize(game.GenerateBlock(false));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateBlock)->DenseRange(0, 100, 25);
+
+// Boards filled to the same percentage with different seeds
+BoardBatch MakeBatch(int64 percent)
+{
+    BoardBatch batch;
+    for (uint32 i = 0; i < BOARD_EVAL_BATCH; i++)
+    {
+        Game game;
+        game.ResetGame(DEFAULT_LEVEL, FIXTURE_SEED);
+        FillBoard(game, percent, FIXTURE_SEED + uint64(percent) + i);
+
+        BotBoard board;
+        board.CopyFrom(game.GetBoard());
+        batch.Add(board.rowMasks);
+    }
+
+    return batch;
+}
+
+static void BM_EvaluateBoards(benchmark::State& state)
+{
+    BoardBatch batch = MakeBatch(state.range(0));
+    BoardFeatures features[BOARD_EVAL_BATCH];
+
+    for (auto _ : state)
+    {
+        EvaluateBoards(batch, features);
+        benchmark::DoNotOptimize(features);
+    }
+
+    state.SetItemsProcessed(state.iterations() * BOARD_EVAL_BATCH);
+}
+BENCHMARK(BM_EvaluateBoards)->DenseRange(0, 100, 25);
+
+static void BM_EvaluateBoardsScalar(benchmark::State& state)
+{
+    BoardBatch batch = MakeBatch(state.range(0));
+    BoardFeatures features[BOARD_EVAL_BATCH];
+
+    for (auto _ : state)
+    {
+        EvaluateBoardsScalar(batch, features);
+        benchmark::DoNotOptimize(features);
+    }
+
+    state.SetItemsProcessed(state.iterations() * BOARD_EVAL_BATCH);
+}
+BENCHMARK(BM_EvaluateBoardsScalar)->DenseRange(0, 100, 25);
+
+// Heights, holes and bumpiness read cell by cell through the game, the way a board was scored before the row masks
+static void BM_EvaluateBoardCells(benchmark::State& state)
+{
+    Game game;
+    SetUpGame(game, state.range(0));
+
+    for (auto _ : state)
+    {
+        BoardFeatures features = {};
+        int32 heights[MAX_WIDTH] = {};
+        for (int32 x = 0; x < MAX_WIDTH; x++)
+        {
+            for (int32 y = 0; y < BOARD_HEIGHT; y++)
+                if (game.GetSubBlockInPosition(x, y))
+                    heights[x] = y + 1;
+
+            for (int32 y = 0; y < heights[x]; y++)
+                if (!game.GetSubBlockInPosition(x, y))
+                    features.holes++;
+
+            features.aggregateHeight += heights[x];
+            if (x > 0)
+                features.bumpiness += std::abs(heights[x] - heights[x - 1]);
+        }
+        benchmark::DoNotOptimize(features);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EvaluateBoardCells)->DenseRange(0, 100, 25);
+
+// Zobrist hash of a board from scratch, what the bot pays before every table probe
+static void BM_HashRowMasks(benchmark::State& state)
+{
+    BoardBatch batch = MakeBatch(state.range(0));
+    uint16 rowMasks[BOARD_EVAL_BATCH][BOARD_HEIGHT];
+    for (uint32 i = 0; i < BOARD_EVAL_BATCH; i++)
+        for (int32 y = 0; y < BOARD_HEIGHT; y++)
+            rowMasks[i][y] = batch.rows[y][i];
+
+    uint32 i = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(HashRowMasks(rowMasks[i++ % BOARD_EVAL_BATCH]));
+}
+BENCHMARK(BM_HashRowMasks)->DenseRange(0, 100, 25);
+
+// Full placement search of the active block with the next one as lookahead, items are the boards scored
+static void BM_BotPlan(benchmark::State& state)
+{
+    Game game;
+    SetUpGame(game, state.range(0));
+    Bot bot;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(bot.Plan(game));
+
+    state.SetItemsProcessed(int64(bot.GetEvaluatedCount()));
+}
+BENCHMARK(BM_BotPlan)->DenseRange(0, 50, 25);
+
+#define FIXTURE_ROLLOUT_BUDGET      1000
+
+static void BM_RolloutSearch(benchmark::State& state)
+{
+    Game game;
+    SetUpGame(game, 25);
+
+    ThreadPool pool(uint32(state.range(0)));
+    RolloutSearch rollouts(&pool);
+    rollouts.SetBudget(FIXTURE_ROLLOUT_BUDGET);
+    Bot bot;
+    bot.SetRolloutSearch(&rollouts);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(bot.Plan(game));
+
+    state.SetItemsProcessed(int64(rollouts.GetRolloutCount()));
+}
+BENCHMARK(BM_RolloutSearch)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+#define FIXTURE_TABLE_KEYS          (1 << 16)
+
+static void BM_TranspositionProbe(benchmark::State& state)
+{
+    TranspositionTable table(size_t(state.range(0)));
+    Random random(FIXTURE_SEED);
+    std::vector<uint64> keys(FIXTURE_TABLE_KEYS * 2);
+    for (uint64& key : keys)
+        key = random.Next64();
+
+    for (uint32 i = 0; i < FIXTURE_TABLE_KEYS; i++)
+        table.Store(keys[i * 2], keys[i]);
+    table.ResetCounters();
+
+    uint64 data = 0;
+    uint32 i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(table.Probe(keys[i], data));
+        i = (i + 1) % keys.size();
+    }
+
+    state.counters["hit_rate"] = table.GetHitRate();
+}
+BENCHMARK(BM_TranspositionProbe)->RangeMultiplier(16)->Range(64 << 10, 64 << 20);
+
+#define FIXTURE_WELL_HEIGHT         20
+
+// Fills the lower half of the well with the same pattern for a given size
+void FillWell(Well3D& well, int64 side)
+{
+    well.Init(int32(side), int32(side), FIXTURE_WELL_HEIGHT);
+    Random random(FIXTURE_SEED + uint64(side));
+    for (int32 y = 0; y < FIXTURE_WELL_HEIGHT / 2; y++)
+        for (int32 z = 0; z < side; z++)
+            for (int32 x = 0; x < side; x++)
+                if (random.Next(100) < 50)
+                    well.SetCell(x, y, z, COLOR_GRAY);
+}
+
+static void BM_Well3DCollides(benchmark::State& state)
+{
+    Well3D well;
+    FillWell(well, state.range(0));
+
+    Random random(FIXTURE_SEED);
+    std::vector<Position3D> positions;
+    for (uint32 i = 0; i < FIXTURE_POSITIONS; i++)
+        positions.push_back(Position3D(int8(random.Next(well.GetWidth())), int8(random.Next(well.GetHeight())), int8(random.Next(well.GetDepth()))));
+
+    for (auto _ : state)
+        for (uint32 i = 0; i < FIXTURE_POSITIONS; i++)
+            benchmark::DoNotOptimize(well.Collides(TYPE_T, uint8(i % NUM_ORIENTATIONS), positions[i].x, positions[i].y, positions[i].z));
+
+    state.SetItemsProcessed(state.iterations() * FIXTURE_POSITIONS);
+}
+BENCHMARK(BM_Well3DCollides)->DenseRange(4, 8, 2);
+
+static void BM_Well3DClearLayers(benchmark::State& state)
+{
+    Well3D well;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        FillWell(well, state.range(0));
+        for (int32 z = 0; z < state.range(0); z++)
+            for (int32 x = 0; x < state.range(0); x++)
+                for (int32 y = 1; y < FIXTURE_WELL_HEIGHT / 2; y += 3)
+                    well.SetCell(x, y, z, COLOR_GRAY);
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(well.ClearLayers(well.GetFullLayers()));
+    }
+}
+BENCHMARK(BM_Well3DClearLayers)->DenseRange(4, 8, 2);
+
+// Hard drops with random moves and turns until the well fills up, then starts again
+static void BM_Game3DHardDrop(benchmark::State& state)
+{
+    Game3D game;
+    Random random(FIXTURE_SEED);
+    int32 side = int32(state.range(0));
+    game.ResetGame(side, side, FIXTURE_WELL_HEIGHT, DEFAULT_LEVEL, FIXTURE_SEED);
+    game.StartGame();
+
+    for (auto _ : state)
+    {
+        if (game.IsGameOver())
+        {
+            game.ResetGame(side, side, FIXTURE_WELL_HEIGHT, DEFAULT_LEVEL, FIXTURE_SEED);
+            game.StartGame();
+        }
+
+        game.ApplyInput(Input3DAction(INPUT_3D_ROTATE_X + random.Next(3)));
+        game.ApplyInput(Input3DAction(INPUT_3D_MOVE_LEFT + random.Next(4)));
+        game.ApplyInput(INPUT_3D_HARD_DROP);
+    }
+}
+BENCHMARK(BM_Game3DHardDrop)->DenseRange(4, 8, 2);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,127 @@
+#include "AssetLoader.h"
+
+// Touched on the worker so the GL thread does not take the page faults of a mapped file
+#define ASSET_PAGE_SIZE 4096
+
+AssetLoader::AssetLoader()
+{
+    m_nextId    = 0;
+    m_pending   = 0;
+    m_stopping  = false;
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeCondition.notify_all();
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+uint32 AssetLoader::Request(AssetType type, const char* filename)
+{
+    std::unique_ptr<Asset> asset(new Asset());
+    asset->type = type;
+    asset->filename = filename;
+    asset->isLoaded = false;
+
+    uint32 id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = asset->id = m_nextId++;
+        m_requests.push_back(std::move(asset));
+        m_pending++;
+
+        // Started with the first request so an unused loader costs nothing
+        if (!m_thread.joinable())
+            m_thread = std::thread(&AssetLoader::WorkerLoop, this);
+    }
+    m_wakeCondition.notify_one();
+
+    return id;
+}
+
+std::unique_ptr<Asset> AssetLoader::PollFinished()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_finished.empty())
+        return nullptr;
+
+    std::unique_ptr<Asset> asset = std::move(m_finished.front());
+    m_finished.pop_front();
+    m_pending--;
+    return asset;
+}
+
+uint32 AssetLoader::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending;
+}
+
+void AssetLoader::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wakeCondition.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+        if (m_stopping)
+            return;
+
+        std::unique_ptr<Asset> asset = std::move(m_requests.front());
+        m_requests.pop_front();
+
+        lock.unlock();
+        Load(*asset);
+        DEBUG_LOG("Asset %u (%s) %s\n", asset->id, asset->filename.c_str(), asset->isLoaded ? "loaded" : "failed");
+        lock.lock();
+
+        m_finished.push_back(std::move(asset));
+    }
+}
+
+void AssetLoader::Load(Asset& asset)
+{
+    switch (asset.type)
+    {
+    case ASSET_MAPPED_IMAGE:
+        if (asset.image.MapBmpFile(asset.filename.c_str()))
+        {
+            const volatile unsigned char* pixels = (const unsigned char*)asset.image.MappedData();
+            size_t size = size_t(asset.image.GetNumRows()) * asset.image.GetNumBytesPerRow();
+            for (size_t i = 0; i < size; i += ASSET_PAGE_SIZE)
+                (void)pixels[i];
+
+            asset.isLoaded = true;
+            break;
+        }
+        [[fallthrough]];
+    case ASSET_IMAGE:
+        asset.isLoaded = asset.image.LoadBmpFile(asset.filename.c_str());
+        break;
+    case ASSET_FILE:
+    {
+        FILE* file = fopen(asset.filename.c_str(), "rb");
+        if (!file)
+            break;
+
+        if (fseek(file, 0, SEEK_END) == 0)
+        {
+            long size = ftell(file);
+            if (size > 0 && fseek(file, 0, SEEK_SET) == 0)
+            {
+                asset.data.resize(size_t(size));
+                asset.isLoaded = fread(asset.data.data(), 1, asset.data.size(), file) == asset.data.size();
+            }
+        }
+        fclose(file);
+        break;
+    }
+    default:
+        break;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include "Common.h"
+#include "RgbImage.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+enum AssetType : uint8
+{
+    ASSET_IMAGE,            // Decoded to RGB
+    ASSET_MAPPED_IMAGE,     // Mapped BGR rows, decoded when the file can't be mapped
+    ASSET_FILE              // Whole file in memory, sounds
+};
+
+struct Asset
+{
+    uint32 id;
+    AssetType type;
+    std::string filename;
+    bool isLoaded;
+
+    RgbImage image;
+    std::vector<char> data;
+};
+
+// Reads and decodes assets on a worker thread into staging memory. The owner polls for the
+// finished ones and does the GL or audio work on its own thread
+class AssetLoader
+{
+public:
+    AssetLoader();
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    uint32 Request(AssetType type, const char* filename);
+
+    // Next finished asset, nullptr when none is ready
+    std::unique_ptr<Asset> PollFinished();
+
+    // Requested and not yet polled
+    uint32 GetPendingCount() const;
+
+private:
+    void WorkerLoop();
+    static void Load(Asset& asset);
+
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::deque<std::unique_ptr<Asset>> m_requests;
+    std::deque<std::unique_ptr<Asset>> m_finished;
+
+    uint32 m_nextId;
+    uint32 m_pending;
+    bool m_stopping;
+};
+
+#endif
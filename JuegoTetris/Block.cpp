@@ -1,6 +1,7 @@
 #include "Block.h"
 #include "Common.h"
 #include "Game.h"
+#include "BlockShapes.h"
 
 SubBlock::SubBlock()
 {
@@ -29,13 +30,13 @@ void SubBlock::Delete()
 
 bool SubBlock::CanDropSubBlock()
 {
-    if (m_position.y <= 0.0f)
+    if (m_position.y <= 0)
     {
         DEBUG_LOG("Block %d hit, can't be dropped (<0).\n", ID);
         return false;
     }
 
-    if (SubBlock* temp = m_game->GetSubBlockInPosition(m_position.x, m_position.y - 1.0f))
+    if (SubBlock* temp = m_game->GetSubBlockInPosition(m_position.x, m_position.y - 1))
     {
         DEBUG_LOG("Block %d hits with block %d\n", ID, temp->GetID());
         return false;
@@ -44,37 +45,40 @@ bool SubBlock::CanDropSubBlock()
     return true;
 }
 
-Block::Block(BlockType type, Game* game, float x, float y)
+Block::Block(BlockType type, Game* game, int8 x, int8 y)
 {
     m_type = type;
+    m_rotation = 0;
     m_game = game;
     m_position.x = x;
     m_position.y = y;
-    m_subBlocks.clear();
+    m_subBlocks.fill(nullptr);
     GenerateSubBlocks();
 }
 
 Block::~Block()
 {
-    m_subBlocks.clear();
 }
 
-void Block::GenerateSubBlocks()
+const BlockShape& Block::GetShape() const
 {
-    uint32 currentID = m_game->GetCurrentBlockID();
+    return GetBlockShape(m_type, m_rotation);
+}
 
+void Block::GenerateSubBlocks()
+{
     // Always have 4 subBlocks
-    Position* positions = Block::GetPositionsOfType(m_type);
+    const Position* positions = GetShape().cells;
     for (uint8 i = 0; i < NUM_BLOCK_SUBBLOCKS; i++)
     {
-        SubBlock* sub = new SubBlock(m_game);
+        SubBlock* sub = m_game->CreateSubBlock();
         Position pos = positions[i];
         SetColor(Block::GetColorByType(m_type));
         sub->SetColor(Block::GetColorByType(m_type));
         sub->SetPosition(pos);
-        m_subBlocks.push_back(sub);
+        m_subBlocks[i] = sub;
 
-        DEBUG_LOG("SubBlock ID: %u created in position X: %f, Y: %f\n", sub->GetID(), pos.x, pos.y);
+        DEBUG_LOG("SubBlock ID: %u created in position X: %d, Y: %d\n", sub->GetID(), pos.x, pos.y);
     }
 }
 
@@ -84,23 +88,8 @@ bool Block::CanRotateBlock()
     if (m_type == TYPE_CUBE)
         return false;
 
-    for (SubBlock* sub : m_subBlocks)
-    {
-        float oldPosX = sub->GetPositionX();
-        float oldPosY = sub->GetPositionY();
-        float newPosX = roundf(oldPosX * cosf(float(M_PI_2)) - oldPosY * sinf(float(M_PI_2)));
-        float newPosY = roundf(oldPosX * sinf(float(M_PI_2)) + oldPosY * cosf(float(M_PI_2)));
-
-        if (m_position.x + newPosX < 0.0f || m_position.x + newPosX > MAX_WIDTH - 1.0f)
-            return false;
-
-        if (m_position.y + newPosY < 0.0f)
-            return false;
-
-        if (m_game->GetSubBlockInPosition(m_position.x + newPosX, m_position.y + newPosY))
-            return false;
-    }
-    return true;
+    const BlockShape& rotated = GetBlockShape(m_type, m_rotation + 1);
+    return !m_game->GetBoard().Collides(rotated, m_position.x, m_position.y);
 }
 
 
@@ -109,153 +98,36 @@ void Block::RotateBlock()
     if (!CanRotateBlock())
         return;
 
-    for(SubBlock* sub : m_subBlocks)
-    {
-        float oldPosX = sub->GetPositionX();
-        float oldPosY = sub->GetPositionY();
-        float newPosX = roundf(oldPosX * cos(float(M_PI_2)) - oldPosY * sin(float(M_PI_2)));
-        float newPosY = roundf(oldPosX * sin(float(M_PI_2)) + oldPosY * cos(float(M_PI_2)));
-
-        sub->SetPositionX(newPosX);
-        sub->SetPositionY(newPosY);
+    m_rotation = (m_rotation + 1) % NUM_ROTATIONS;
 
-        DEBUG_LOG("SubBlock OldPosition: (%f, %f), newPosition: (%f, %f)\n", oldPosX, oldPosY, sub->GetPositionX(), sub->GetPositionY());
-    }
+    const BlockShape& shape = GetShape();
+    for (uint8 i = 0; i < NUM_BLOCK_SUBBLOCKS; i++)
+        m_subBlocks[i]->SetPosition(shape.cells[i]);
 }
 
-Position* Block::GetPositionsOfType(BlockType type)
+const Position* Block::GetPositionsOfType(BlockType type)
 {
-    static Position positions[NUM_BLOCK_SUBBLOCKS];
-    switch(type)
-    {
-        case TYPE_CUBE:
-            positions[0] = {0.0f, 0.0f};
-            positions[1] = {1.0f, 0.0f};
-            positions[2] = {0.0f, 1.0f};
-            positions[3] = {1.0f, 1.0f};
-            break;
-        case TYPE_PRISM:
-            positions[0] = {-1.0f, 0.0f};
-            positions[1] = {0.0f, 0.0f};
-            positions[2] = {1.0f, 0.0f};
-            positions[3] = {2.0f, 0.0f};
-            break;
-        case TYPE_T:
-            positions[0] = {0.0f, 0.0f};
-            positions[1] = {1.0f, 0.0f};
-            positions[2] = {2.0f, 0.0f};
-            positions[3] = {1.0f, 1.0f};
-            break;
-        case TYPE_Z:
-            positions[0] = {0.0f, 0.0f};
-            positions[1] = {1.0f, 0.0f};
-            positions[2] = {1.0f, 1.0f};
-            positions[3] = {2.0f, 1.0f};
-            break;
-        case TYPE_L:
-            positions[0] = {0.0f, 0.0f};
-            positions[1] = {1.0f, 0.0f};
-            positions[2] = {2.0f, 0.0f};
-            positions[3] = {2.0f, 1.0f};
-            break;
-        case TYPE_Z_INV:
-            positions[0] = {0.0f, 1.0f};
-            positions[1] = {1.0f, 1.0f};
-            positions[2] = {1.0f, 0.0f};
-            positions[3] = {2.0f, 0.0f};
-            break;
-        case TYPE_L_INV:
-            positions[0] = {0.0f, 0.0f};
-            positions[1] = {0.0f, 1.0f};
-            positions[2] = {1.0f, 0.0f};
-            positions[3] = {2.0f, 0.0f};
-            break;
-        default:
-            break;
-    }
-
-    return positions;
+    return GetBlockShape(type, 0).cells;
 }
 
 void Block::Drop()
 {
-    bool found = false;
-
-    float posY = m_position.y;
-    for (posY; posY > 0.0f; posY -= 1.0f)
-    {
-        if (found)
-            break;
-
-        for (SubBlock* sub : GetSubBlocks())
-        {
-            if (posY + sub->GetPositionY() - 1.0f <= 0.0f)
-            {
-                found = true;
-                break;
-            }
-
-            if (SubBlock* temp = m_game->GetSubBlockInPosition(m_position.x + sub->GetPositionX(), posY + sub->GetPositionY() - 2.0f))
-            {
-                found = true;
-                DEBUG_LOG("Block %d hits with block %d\n", sub->GetID(), temp->GetID());
-                break;
-            }
-        }
-    }
+    m_position.y = int8(GetLandingY());
+}
 
-    if (m_position.y != posY)
-        m_position.y = posY;
+int32 Block::GetLandingY() const
+{
+    return m_position.y - m_game->GetBoard().GetDropDistance(GetShape(), m_position.x, m_position.y);
 }
 
 bool Block::CanDropBlock()
 {
-    for (SubBlock* sub : GetSubBlocks())
-    {
-        if (m_position.y + sub->GetPositionY() <= 0.0f)
-        {
-            DEBUG_LOG("Block %d hits can't be dropped (<0).\n", sub->GetID());
-            return false;
-        }
-
-        if (SubBlock* temp = m_game->GetSubBlockInPosition(m_position.x + sub->GetPositionX(), m_position.y + sub->GetPositionY() - 1.0f))
-        {
-            DEBUG_LOG("Block %d hits with block %d\n", sub->GetID(), temp->GetID());
-            return false;
-        }
-    }
-
-    return true;
+    return !m_game->GetBoard().Collides(GetShape(), m_position.x, m_position.y - 1);
 }
 
 bool Block::CanMoveBlock(bool right)
 {
-    for (SubBlock* sub : m_subBlocks)
-    {
-        if (right)
-        {
-            if (m_position.x + sub->GetPositionX() >= MAX_WIDTH - 1)
-                return false;
-
-            if (SubBlock* temp = m_game->GetSubBlockInPosition(m_position.x + sub->GetPositionX() + 1, m_position.y + sub->GetPositionY()))
-            {
-                DEBUG_LOG("Block %d hits with block %d\n", sub->GetID(), temp->GetID());
-                return false;
-            }
-        }
-        else
-        {
-            if (m_position.x + sub->GetPositionX() <= 0.0f)
-                return false;
-
-            if (SubBlock* temp = m_game->GetSubBlockInPosition(m_position.x + sub->GetPositionX() - 1, m_position.y + sub->GetPositionY()))
-            {
-                DEBUG_LOG("Block %d hits with block %d\n", sub->GetID(), temp->GetID());
-                return false;
-            }
-        }
-    }
-    return true;
+    return !m_game->GetBoard().Collides(GetShape(), m_position.x + (right ? 1 : -1), m_position.y);
 }
 
 void Block::MoveBlock(bool right)
@@ -263,7 +135,7 @@ void Block::MoveBlock(bool right)
     if (!CanMoveBlock(right))
         return;
 
-    m_position.x += right ? 1.0f : -1.0f;
+    m_position.x += right ? 1 : -1;
 }
 
 Color Block::GetColorByType(BlockType type)
@@ -300,11 +172,11 @@ Color Block::GetColorByType(BlockType type)
 
 void SubBlock::DebugPosition()
 {
-    DEBUG_LOG("Block %u, Position [%f, %f, %f]\n", ID, m_position.x, m_position.y, m_position.z);
+    DEBUG_LOG("Block %u, Position [%d, %d]\n", ID, m_position.x, m_position.y);
 }
 
 void Block::DebugPosition()
 {
     for (SubBlock const* sub : m_subBlocks)
-        DEBUG_LOG("Block %u (ActiveBlock), Position [%f, %f, %f]\n", sub->GetID(), double(m_position.x) + sub->GetPositionX(), double(m_position.y) + sub->GetPositionY(), double(m_position.z) + sub->GetPositionZ());
+        DEBUG_LOG("Block %u (ActiveBlock), Position [%d, %d]\n", sub->GetID(), m_position.x + sub->GetPositionX(), m_position.y + sub->GetPositionY());
 }
@@ -2,6 +2,7 @@
 #define BLOCK_H
 
 #include "Common.h"
+#include <array>
 
 enum Color : int8
 {
@@ -14,7 +15,8 @@ enum Color : int8
     COLOR_CYAN,
     COLOR_PINK,
     COLOR_ORANGE,
-    COLOR_GRAY
+    COLOR_GRAY,
+    MAX_COLOR
 };
     
 enum BlockType : int8
@@ -30,24 +32,26 @@ enum BlockType : int8
     MAX_BLOCK_TYPE
 };
 
+// Cell coordinates on the board, column and row
 struct Position
 {
-    Position() { x = 0.0f; y = 0.0f; z = 0.0f; }
-    Position(float _x, float _y) { x = _x; y = _y; z = 0.0f; }
-    Position(float _x, float _y, float _z) { x = _x; y = _y; z = _z; }
+    constexpr Position() : x(0), y(0) { }
+    constexpr Position(int8 _x, int8 _y) : x(_x), y(_y) { }
 
-    float x, y, z;
+    int8 x, y;
 
-    inline bool operator==(const Position &other) { return x == other.x && y == other.y && z == other.z; }
+    inline bool operator==(const Position &other) const { return x == other.x && y == other.y; }
 };
 
 class Game;
+struct BlockShape;
 
 class SubBlock
 {
 public:
 
     typedef std::vector<SubBlock*> SubBlockVector;
+    typedef std::array<SubBlock*, NUM_BLOCK_SUBBLOCKS> SubBlockArray;
 
     SubBlock();
     SubBlock(Game* game);
@@ -60,14 +64,11 @@ public:
     Position GetPosition() const { return m_position; }
     void SetPosition(Position _position) { m_position = _position; }
 
-    float GetPositionX() const { return m_position.x; }
-    void SetPositionX(float x) { m_position.x = x; }
+    int8 GetPositionX() const { return m_position.x; }
+    void SetPositionX(int8 x) { m_position.x = x; }
 
-    float GetPositionY() const { return m_position.y; }
-    void SetPositionY(float y) { m_position.y = y;}
-    
-    float GetPositionZ() const { return m_position.z; }
-    void SetPositionZ(float z) { m_position.z = z; }
+    int8 GetPositionY() const { return m_position.y; }
+    void SetPositionY(int8 y) { m_position.y = y;}
 
     Game* GetGame() const { return m_game; }
     void SetGame(Game* game) { m_game = game; }
@@ -102,24 +103,31 @@ protected:
 class Block : public SubBlock
 {
 public:
-    Block(BlockType type, Game* game, float x, float y);
+    Block(BlockType type, Game* game, int8 x, int8 y);
     ~Block();
 
     BlockType GetType() const { return m_type; }
     void SetType(BlockType type) { m_type = type; }
 
+    uint8 GetRotation() const { return m_rotation; }
+    const BlockShape& GetShape() const;
+
     void GenerateSubBlocks();
     void RotateBlock();
     void Drop();
     void MoveBlock(bool right);
 
     bool CanDropBlock();
+
+    // Row the block origin would rest on after a hard drop, for ghost pieces and bots
+    int32 GetLandingY() const;
     bool CanRotateBlock();
     bool CanMoveBlock(bool right);
 
-    static Position* GetPositionsOfType(BlockType type);
+    static const Position* GetPositionsOfType(BlockType type);
 
-    SubBlockVector GetSubBlocks() const { return m_subBlocks; }
+    const SubBlockArray& GetSubBlocks() const { return m_subBlocks; }
+    void DetachSubBlocks() { m_subBlocks.fill(nullptr); }
 
     static Color GetColorByType(BlockType type);
 
@@ -127,8 +135,9 @@ public:
 
 private:
     BlockType m_type;
+    uint8 m_rotation;
 
-    SubBlockVector m_subBlocks;
+    SubBlockArray m_subBlocks;
 };
 
 #endif
@@ -0,0 +1,91 @@
+#ifndef BLOCK_SHAPES_H
+#define BLOCK_SHAPES_H
+
+#include "Common.h"
+#include "Block.h"
+
+#define NUM_ROTATIONS               4
+
+// One orientation of a block: sub-block offsets, bounding box, a bit mask per covered row
+// (bit 0 of rowMasks[i] is column minX of row minY + i) and the lowest offset in each covered column
+struct BlockShape
+{
+    Position cells[NUM_BLOCK_SUBBLOCKS];
+    int8 minX, maxX, minY, maxY;
+    uint16 rowMasks[NUM_BLOCK_SUBBLOCKS];
+    int8 columnBottoms[NUM_BLOCK_SUBBLOCKS];
+};
+
+struct BlockShapeTable
+{
+    BlockShape shapes[MAX_BLOCK_TYPE][NUM_ROTATIONS];
+};
+
+constexpr Position BASE_BLOCK_POSITIONS[MAX_BLOCK_TYPE][NUM_BLOCK_SUBBLOCKS] =
+{
+    /* TYPE_NONE  */ { {  0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } },
+    /* TYPE_CUBE  */ { {  0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } },
+    /* TYPE_PRISM */ { { -1, 0 }, { 0, 0 }, { 1, 0 }, { 2, 0 } },
+    /* TYPE_L     */ { {  0, 0 }, { 1, 0 }, { 2, 0 }, { 2, 1 } },
+    /* TYPE_L_INV */ { {  0, 0 }, { 0, 1 }, { 1, 0 }, { 2, 0 } },
+    /* TYPE_T     */ { {  0, 0 }, { 1, 0 }, { 2, 0 }, { 1, 1 } },
+    /* TYPE_Z     */ { {  0, 0 }, { 1, 0 }, { 1, 1 }, { 2, 1 } },
+    /* TYPE_Z_INV */ { {  0, 1 }, { 1, 1 }, { 1, 0 }, { 2, 0 } },
+};
+
+constexpr BlockShape MakeBlockShape(BlockType type, uint8 rotation)
+{
+    BlockShape shape = {};
+    for (uint8 i = 0; i < NUM_BLOCK_SUBBLOCKS; i++)
+    {
+        Position pos = BASE_BLOCK_POSITIONS[type][i];
+
+        // Rotation of 90 degrees counterclockwise: (x, y) -> (-y, x). Cube should not rotate
+        for (uint8 r = 0; type != TYPE_CUBE && r < rotation; r++)
+            pos = Position(int8(-pos.y), pos.x);
+
+        shape.cells[i] = pos;
+    }
+
+    shape.minX = shape.maxX = shape.cells[0].x;
+    shape.minY = shape.maxY = shape.cells[0].y;
+    for (uint8 i = 1; i < NUM_BLOCK_SUBBLOCKS; i++)
+    {
+        shape.minX = std::min(shape.minX, shape.cells[i].x);
+        shape.maxX = std::max(shape.maxX, shape.cells[i].x);
+        shape.minY = std::min(shape.minY, shape.cells[i].y);
+        shape.maxY = std::max(shape.maxY, shape.cells[i].y);
+    }
+
+    for (uint8 i = 0; i < NUM_BLOCK_SUBBLOCKS; i++)
+        shape.columnBottoms[i] = shape.maxY;
+
+    for (uint8 i = 0; i < NUM_BLOCK_SUBBLOCKS; i++)
+    {
+        const Position& cell = shape.cells[i];
+        shape.rowMasks[cell.y - shape.minY] |= uint16(1 << (cell.x - shape.minX));
+        shape.columnBottoms[cell.x - shape.minX] = std::min(shape.columnBottoms[cell.x - shape.minX], cell.y);
+    }
+
+    return shape;
+}
+
+constexpr BlockShapeTable MakeBlockShapeTable()
+{
+    BlockShapeTable table = {};
+    for (uint8 type = 0; type < MAX_BLOCK_TYPE; type++)
+        for (uint8 rotation = 0; rotation < NUM_ROTATIONS; rotation++)
+            table.shapes[type][rotation] = MakeBlockShape(BlockType(type), rotation);
+
+    return table;
+}
+
+// Built at compile time, read only and shared by every game
+constexpr BlockShapeTable BLOCK_SHAPES = MakeBlockShapeTable();
+
+inline const BlockShape& GetBlockShape(BlockType type, uint8 rotation)
+{
+    return BLOCK_SHAPES.shapes[type][rotation % NUM_ROTATIONS];
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef BLOCK_SHAPES_3D_H
+#define BLOCK_SHAPES_3D_H
+
+#include "Common.h"
+#include "BlockShapes.h"
+
+// Rotations of a cube, every piece can reach all of them
+#define NUM_ORIENTATIONS            24
+
+enum RotationAxis : uint8
+{
+    AXIS_X = 0,
+    AXIS_Y,
+    AXIS_Z,
+    MAX_AXIS
+};
+
+// Cell coordinates in the well: column, layer and row in depth
+struct Position3D
+{
+    constexpr Position3D() : x(0), y(0), z(0) { }
+    constexpr Position3D(int8 _x, int8 _y, int8 _z) : x(_x), y(_y), z(_z) { }
+
+    int8 x, y, z;
+
+    inline bool operator==(const Position3D &other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct Orientation3D
+{
+    int8 matrix[3][3];
+};
+
+// Every orientation as a rotation matrix and the orientation reached by a 90 degree turn about each axis
+struct OrientationTable
+{
+    Orientation3D orientations[NUM_ORIENTATIONS];
+    uint8 next[NUM_ORIENTATIONS][MAX_AXIS];
+};
+
+// One orientation of a block in the well: sub-block offsets and bounding box
+struct BlockShape3D
+{
+    Position3D cells[NUM_BLOCK_SUBBLOCKS];
+    int8 minX, maxX, minY, maxY, minZ, maxZ;
+};
+
+struct BlockShape3DTable
+{
+    BlockShape3D shapes[MAX_BLOCK_TYPE][NUM_ORIENTATIONS];
+};
+
+// Counterclockwise quarter turns, the one about z is the rotation of the 2D game
+constexpr Orientation3D AXIS_ROTATIONS[MAX_AXIS] =
+{
+    { { { 1, 0,  0 }, { 0, 0, -1 }, {  0, 1, 0 } } },
+    { { { 0, 0,  1 }, { 0, 1,  0 }, { -1, 0, 0 } } },
+    { { { 0, -1, 0 }, { 1, 0,  0 }, {  0, 0, 1 } } },
+};
+
+constexpr Orientation3D MultiplyOrientations(const Orientation3D& a, const Orientation3D& b)
+{
+    Orientation3D result = {};
+    for (int32 i = 0; i < 3; i++)
+        for (int32 j = 0; j < 3; j++)
+            for (int32 k = 0; k < 3; k++)
+                result.matrix[i][j] += int8(a.matrix[i][k] * b.matrix[k][j]);
+
+    return result;
+}
+
+constexpr bool IsSameOrientation(const Orientation3D& a, const Orientation3D& b)
+{
+    for (int32 i = 0; i < 3; i++)
+        for (int32 j = 0; j < 3; j++)
+            if (a.matrix[i][j] != b.matrix[i][j])
+                return false;
+
+    return true;
+}
+
+constexpr OrientationTable MakeOrientationTable()
+{
+    // Breadth first from the identity, turning about each axis finds all 24 rotations
+    OrientationTable table = {};
+    for (int32 i = 0; i < 3; i++)
+        table.orientations[0].matrix[i][i] = 1;
+
+    uint8 count = 1;
+    for (uint8 current = 0; current < count; current++)
+    {
+        for (uint8 axis = 0; axis < MAX_AXIS; axis++)
+        {
+            Orientation3D rotated = MultiplyOrientations(AXIS_ROTATIONS[axis], table.orientations[current]);
+
+            uint8 index = 0;
+            while (index < count && !IsSameOrientation(table.orientations[index], rotated))
+                index++;
+
+            if (index == count)
+                table.orientations[count++] = rotated;
+
+            table.next[current][axis] = index;
+        }
+    }
+
+    return table;
+}
+
+constexpr OrientationTable ORIENTATIONS_3D = MakeOrientationTable();
+
+constexpr BlockShape3D MakeBlockShape3D(BlockType type, uint8 orientation)
+{
+    // The flat pieces of the 2D game, lying on the xy plane before they are turned
+    const Orientation3D& rotation = ORIENTATIONS_3D.orientations[orientation];
+    BlockShape3D shape = {};
+    for (uint8 i = 0; i < NUM_BLOCK_SUBBLOCKS; i++)
+    {
+        int8 base[3] = { BASE_BLOCK_POSITIONS[type][i].x, BASE_BLOCK_POSITIONS[type][i].y, 0 };
+        int8 cell[3] = { 0, 0, 0 };
+        for (int32 row = 0; row < 3; row++)
+            for (int32 column = 0; column < 3; column++)
+                cell[row] += int8(rotation.matrix[row][column] * base[column]);
+
+        shape.cells[i] = Position3D(cell[0], cell[1], cell[2]);
+    }
+
+    shape.minX = shape.maxX = shape.cells[0].x;
+    shape.minY = shape.maxY = shape.cells[0].y;
+    shape.minZ = shape.maxZ = shape.cells[0].z;
+    for (uint8 i = 1; i < NUM_BLOCK_SUBBLOCKS; i++)
+    {
+        shape.minX = std::min(shape.minX, shape.cells[i].x);
+        shape.maxX = std::max(shape.maxX, shape.cells[i].x);
+        shape.minY = std::min(shape.minY, shape.cells[i].y);
+        shape.maxY = std::max(shape.maxY, shape.cells[i].y);
+        shape.minZ = std::min(shape.minZ, shape.cells[i].z);
+        shape.maxZ = std::max(shape.maxZ, shape.cells[i].z);
+    }
+
+    return shape;
+}
+
+constexpr BlockShape3DTable MakeBlockShape3DTable()
+{
+    BlockShape3DTable table = {};
+    for (uint8 type = 0; type < MAX_BLOCK_TYPE; type++)
+        for (uint8 orientation = 0; orientation < NUM_ORIENTATIONS; orientation++)
+            table.shapes[type][orientation] = MakeBlockShape3D(BlockType(type), orientation);
+
+    return table;
+}
+
+// Built at compile time, read only and shared by every well
+constexpr BlockShape3DTable BLOCK_SHAPES_3D = MakeBlockShape3DTable();
+
+inline const BlockShape3D& GetBlockShape3D(BlockType type, uint8 orientation)
+{
+    return BLOCK_SHAPES_3D.shapes[type][orientation % NUM_ORIENTATIONS];
+}
+
+inline uint8 RotateOrientation(uint8 orientation, RotationAxis axis)
+{
+    return ORIENTATIONS_3D.next[orientation % NUM_ORIENTATIONS][axis];
+}
+
+#endif
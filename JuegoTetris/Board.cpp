@@ -0,0 +1,176 @@
+#include "Board.h"
+#include "Block.h"
+#include "Zobrist.h"
+
+Board::Board()
+{
+    Clear();
+}
+
+void Board::Clear()
+{
+    for (int32 y = 0; y < BOARD_HEIGHT; y++)
+    {
+        m_rowMasks[y] = 0;
+        for (int32 x = 0; x < BOARD_WIDTH; x++)
+            m_cells[y][x] = nullptr;
+    }
+
+    for (int32 x = 0; x < BOARD_WIDTH; x++)
+        m_columnHeights[x] = 0;
+
+    m_hash = 0;
+}
+
+void Board::SetSubBlock(int32 x, int32 y, SubBlock* sub)
+{
+    if (!IsInside(x, y))
+    {
+        DEBUG_LOG("SubBlock out of board in position X: %d, Y: %d\n", x, y);
+        return;
+    }
+
+    if (!IsOccupied(x, y))
+        m_hash ^= GetZobristCellKey(x, y);
+
+    m_rowMasks[y] |= uint16(1 << x);
+    m_cells[y][x] = sub;
+    m_columnHeights[x] = int8(std::max<int32>(m_columnHeights[x], y + 1));
+}
+
+void Board::RemoveSubBlock(int32 x, int32 y)
+{
+    if (!IsOccupied(x, y))
+        return;
+
+    m_hash ^= GetZobristCellKey(x, y);
+    m_rowMasks[y] &= uint16(~(1 << x));
+    m_cells[y][x] = nullptr;
+
+    if (m_columnHeights[x] == y + 1)
+        UpdateColumnHeight(x);
+}
+
+void Board::UpdateColumnHeight(int32 x)
+{
+    int32 y = m_columnHeights[x] - 1;
+    while (y >= 0 && !(m_rowMasks[y] & (1 << x)))
+        y--;
+
+    m_columnHeights[x] = int8(y + 1);
+}
+
+void Board::UpdateColumnHeights()
+{
+    // Walk down from the top until every column has found its highest cell
+    uint32 pending = FULL_ROW_MASK;
+    for (int32 x = 0; x < BOARD_WIDTH; x++)
+        m_columnHeights[x] = 0;
+
+    for (int32 y = BOARD_HEIGHT - 1; y >= 0 && pending; y--)
+    {
+        uint32 found = m_rowMasks[y] & pending;
+        pending &= ~found;
+        for (; found; found &= found - 1)
+            m_columnHeights[CountTrailingZeros(found)] = int8(y + 1);
+    }
+}
+
+int32 Board::GetMaxHeight() const
+{
+    int32 height = 0;
+    for (int32 x = 0; x < BOARD_WIDTH; x++)
+        height = std::max<int32>(height, m_columnHeights[x]);
+
+    return height;
+}
+
+int32 Board::GetDropDistance(const BlockShape& shape, int32 x, int32 y) const
+{
+    // Landing row from the surface profile, valid while every column of the block is above its surface
+    int32 distance = y + shape.minY;
+    for (int32 i = 0; i <= shape.maxX - shape.minX; i++)
+    {
+        int32 bottom = y + shape.columnBottoms[i];
+        int32 height = GetColumnHeight(x + shape.minX + i);
+        if (bottom < height)
+        {
+            // Block under an overhang, fall back to test row by row
+            distance = 0;
+            while (!Collides(shape, x, y - distance - 1))
+                distance++;
+
+            return distance;
+        }
+
+        distance = std::min(distance, bottom - height);
+    }
+
+    return std::max(distance, 0);
+}
+
+bool Board::Collides(const BlockShape& shape, int32 x, int32 y) const
+{
+    int32 left = x + shape.minX;
+    int32 bottom = y + shape.minY;
+    if (left < 0 || x + shape.maxX >= BOARD_WIDTH || bottom < 0)
+        return true;
+
+    // Rows above the board are always empty
+    for (int32 i = 0; i <= shape.maxY - shape.minY; i++)
+        if (GetRowMask(bottom + i) & (shape.rowMasks[i] << left))
+            return true;
+
+    return false;
+}
+
+uint32 Board::GetFullRows() const
+{
+    uint32 rows = 0;
+    for (int32 y = 0; y < BOARD_HEIGHT; y++)
+        if (m_rowMasks[y] == FULL_ROW_MASK)
+            rows |= 1u << y;
+
+    return rows;
+}
+
+uint32 Board::ClearRows(uint32 rows)
+{
+    if (!rows)
+        return 0;
+
+    int32 target = 0;
+    for (int32 y = 0; y < BOARD_HEIGHT; y++)
+    {
+        if (rows & (1u << y))
+            continue;
+
+        if (target != y)
+        {
+            uint16 mask = m_rowMasks[y];
+            m_rowMasks[target] = mask;
+            for (int32 x = 0; x < BOARD_WIDTH; x++)
+            {
+                SubBlock* sub = m_cells[y][x];
+                m_cells[target][x] = sub;
+                if (mask & (1 << x))
+                    sub->SetPositionY(int8(target));
+            }
+        }
+        target++;
+    }
+
+    for (; target < BOARD_HEIGHT; target++)
+    {
+        m_rowMasks[target] = 0;
+        for (int32 x = 0; x < BOARD_WIDTH; x++)
+            m_cells[target][x] = nullptr;
+    }
+
+    UpdateColumnHeights();
+
+    // Every cell above the lowest cleared row has moved, hashing the board again is as cheap as fixing it up
+    m_hash = HashRowMasks(m_rowMasks);
+
+    return CountBits(rows);
+}
@@ -0,0 +1,64 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "Common.h"
+#include "BlockShapes.h"
+
+class SubBlock;
+
+// Extra rows above MAX_HEIGHT, a new active block is spawned there
+#define BOARD_HIDDEN_ROWS           5
+
+constexpr int32 BOARD_WIDTH  = MAX_WIDTH;
+constexpr int32 BOARD_HEIGHT = MAX_HEIGHT + BOARD_HIDDEN_ROWS;
+constexpr uint16 FULL_ROW_MASK = uint16((1 << BOARD_WIDTH) - 1);
+
+// Packed playfield: one bit per cell in a row mask plus a parallel plane with the SubBlock placed in each cell.
+class Board
+{
+public:
+    Board();
+
+    void Clear();
+
+    static bool IsInside(int32 x, int32 y) { return x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT; }
+
+    bool IsOccupied(int32 x, int32 y) const { return IsInside(x, y) && (m_rowMasks[y] & (1 << x)) != 0; }
+
+    SubBlock* GetSubBlock(int32 x, int32 y) const { return IsOccupied(x, y) ? m_cells[y][x] : nullptr; }
+    void SetSubBlock(int32 x, int32 y, SubBlock* sub);
+    void RemoveSubBlock(int32 x, int32 y);
+
+    uint16 GetRowMask(int32 y) const { return (y >= 0 && y < BOARD_HEIGHT) ? m_rowMasks[y] : 0; }
+    bool IsRowFull(int32 y) const { return GetRowMask(y) == FULL_ROW_MASK; }
+
+    // Bit y set for every full row
+    uint32 GetFullRows() const;
+    // Removes the given rows and moves the ones above down in a single pass, returns the number of rows removed
+    uint32 ClearRows(uint32 rows);
+
+    // True if the shape placed with its origin in (x, y) leaves the board sides/floor or overlaps a filled cell
+    bool Collides(const BlockShape& shape, int32 x, int32 y) const;
+
+    // Surface profile: number of rows up to the highest filled cell of each column, 0 for an empty column
+    int32 GetColumnHeight(int32 x) const { return (x >= 0 && x < BOARD_WIDTH) ? m_columnHeights[x] : 0; }
+    const int8* GetColumnHeights() const { return m_columnHeights; }
+    int32 GetMaxHeight() const;
+
+    // Rows the shape can fall from (x, y) before it rests on the floor or the stack
+    int32 GetDropDistance(const BlockShape& shape, int32 x, int32 y) const;
+
+    // Zobrist hash of the filled cells, kept up to date on every change
+    uint64 GetHash() const { return m_hash; }
+
+private:
+    void UpdateColumnHeight(int32 x);
+    void UpdateColumnHeights();
+
+    uint16 m_rowMasks[BOARD_HEIGHT];
+    int8 m_columnHeights[BOARD_WIDTH];
+    uint64 m_hash;
+    SubBlock* m_cells[BOARD_HEIGHT][BOARD_WIDTH];
+};
+
+#endif
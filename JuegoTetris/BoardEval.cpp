@@ -0,0 +1,207 @@
+#include "BoardEval.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BOARD_EVAL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BOARD_EVAL_SSE2
+#endif
+
+// A row shifted one column to the left with a filled wall on each side
+#define WALL_MASK                   ((1 << (BOARD_WIDTH + 1)) | 1)
+#define WALLED_ROW_MASK             ((1 << (BOARD_WIDTH + 1)) - 1)
+
+// The vector kernels keep per byte bit counts of every row and the top edge, 8 at most, without overflowing a byte
+static_assert((BOARD_HEIGHT + 1) * 8 < 256, "Board too high for the byte counters of the vector kernels");
+static_assert(BOARD_WIDTH + 2 <= 16, "Board too wide for 16 bit lanes");
+
+void BoardBatch::Clear()
+{
+    memset(rows, 0, sizeof(rows));
+    count = 0;
+}
+
+uint32 BoardBatch::Add(const uint16* rowMasks)
+{
+    uint32 index = count++;
+    for (int32 y = 0; y < BOARD_HEIGHT; y++)
+        rows[y][index] = rowMasks[y];
+
+    return index;
+}
+
+BoardFeatures EvaluateBoard(const uint16* rowMasks)
+{
+    BoardFeatures features = {};
+
+    // Cells in the top row change to the empty space above the board
+    features.columnTransitions = CountBits(rowMasks[BOARD_HEIGHT - 1]);
+
+    // Top down, cover holds every column that has a cell in this row or above it: its bits are the
+    // columns still under their height, so each feature is a bit count per row
+    uint32 cover = 0;
+    for (int32 y = BOARD_HEIGHT - 1; y >= 0; y--)
+    {
+        uint32 row = rowMasks[y];
+        uint32 below = y > 0 ? rowMasks[y - 1] : FULL_ROW_MASK;
+        features.columnTransitions += CountBits(row ^ below);
+
+        cover |= row;
+        if (!cover)
+            continue;
+
+        uint32 walledRow = (row << 1) | WALL_MASK;
+        uint32 walledCover = (cover << 1) | WALL_MASK;
+        features.maxHeight++;
+        features.aggregateHeight += CountBits(cover);
+        features.holes += CountBits(cover & ~row);
+        features.bumpiness += CountBits((cover ^ (cover >> 1)) & (FULL_ROW_MASK >> 1));
+        features.rowTransitions += CountBits((walledRow ^ (walledRow >> 1)) & WALLED_ROW_MASK);
+        features.wellDepth += CountBits(~cover & walledCover & (walledCover >> 2) & FULL_ROW_MASK);
+    }
+
+    return features;
+}
+
+void EvaluateBoardsScalar(const BoardBatch& batch, BoardFeatures* features)
+{
+    uint16 rowMasks[BOARD_HEIGHT];
+    for (uint32 i = 0; i < batch.count; i++)
+    {
+        for (int32 y = 0; y < BOARD_HEIGHT; y++)
+            rowMasks[y] = batch.rows[y][i];
+
+        features[i] = EvaluateBoard(rowMasks);
+    }
+}
+
+#if defined(BOARD_EVAL_AVX2) || defined(BOARD_EVAL_SSE2)
+
+#ifdef BOARD_EVAL_AVX2
+typedef __m256i Lanes;
+#define LANES_PER_VECTOR            16
+
+inline Lanes LoadLanes(const uint16* data) { return _mm256_load_si256((const __m256i*)data); }
+inline void StoreLanes(uint16* data, Lanes v) { _mm256_store_si256((__m256i*)data, v); }
+inline Lanes SetLanes(int16 value) { return _mm256_set1_epi16(value); }
+inline Lanes Or(Lanes a, Lanes b) { return _mm256_or_si256(a, b); }
+inline Lanes And(Lanes a, Lanes b) { return _mm256_and_si256(a, b); }
+inline Lanes AndNot(Lanes a, Lanes b) { return _mm256_andnot_si256(a, b); }
+inline Lanes Xor(Lanes a, Lanes b) { return _mm256_xor_si256(a, b); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_epi16(a, b); }
+inline Lanes Sub(Lanes a, Lanes b) { return _mm256_sub_epi16(a, b); }
+inline Lanes IsZero(Lanes a) { return _mm256_cmpeq_epi16(a, _mm256_setzero_si256()); }
+#define ShiftLeft(v, bits)          _mm256_slli_epi16(v, bits)
+#define ShiftRight(v, bits)         _mm256_srli_epi16(v, bits)
+#else
+typedef __m128i Lanes;
+#define LANES_PER_VECTOR            8
+
+inline Lanes LoadLanes(const uint16* data) { return _mm_load_si128((const __m128i*)data); }
+inline void StoreLanes(uint16* data, Lanes v) { _mm_store_si128((__m128i*)data, v); }
+inline Lanes SetLanes(int16 value) { return _mm_set1_epi16(value); }
+inline Lanes Or(Lanes a, Lanes b) { return _mm_or_si128(a, b); }
+inline Lanes And(Lanes a, Lanes b) { return _mm_and_si128(a, b); }
+inline Lanes AndNot(Lanes a, Lanes b) { return _mm_andnot_si128(a, b); }
+inline Lanes Xor(Lanes a, Lanes b) { return _mm_xor_si128(a, b); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm_add_epi16(a, b); }
+inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_epi16(a, b); }
+inline Lanes IsZero(Lanes a) { return _mm_cmpeq_epi16(a, _mm_setzero_si128()); }
+#define ShiftLeft(v, bits)          _mm_slli_epi16(v, bits)
+#define ShiftRight(v, bits)         _mm_srli_epi16(v, bits)
+#endif
+
+enum LaneFeature : uint8
+{
+    LANE_AGGREGATE_HEIGHT = 0,
+    LANE_MAX_HEIGHT,
+    LANE_HOLES,
+    LANE_BUMPINESS,
+    LANE_ROW_TRANSITIONS,
+    LANE_COLUMN_TRANSITIONS,
+    LANE_WELL_DEPTH,
+    MAX_LANE_FEATURE
+};
+
+// Bit count of each byte of the lanes, left per byte so the rows can be summed before the final fold
+inline Lanes CountByteBits(Lanes v)
+{
+    v = Sub(v, And(ShiftRight(v, 1), SetLanes(0x5555)));
+    v = Add(And(v, SetLanes(0x3333)), And(ShiftRight(v, 2), SetLanes(0x3333)));
+    return And(Add(v, ShiftRight(v, 4)), SetLanes(0x0F0F));
+}
+
+inline Lanes FoldBytes(Lanes v)
+{
+    return Add(And(v, SetLanes(0x00FF)), ShiftRight(v, 8));
+}
+
+// Same features as EvaluateBoard, one board per lane
+void EvaluateLanes(const BoardBatch& batch, uint32 first, uint16 (*results)[BOARD_EVAL_BATCH])
+{
+    const Lanes walls = SetLanes(WALL_MASK);
+    const Lanes one = SetLanes(1);
+
+    Lanes sums[MAX_LANE_FEATURE];
+    for (uint32 i = 0; i < MAX_LANE_FEATURE; i++)
+        sums[i] = SetLanes(0);
+
+    Lanes cover = SetLanes(0);
+    Lanes row = LoadLanes(&batch.rows[BOARD_HEIGHT - 1][first]);
+    sums[LANE_COLUMN_TRANSITIONS] = CountByteBits(row);
+    for (int32 y = BOARD_HEIGHT - 1; y >= 0; y--)
+    {
+        Lanes below = y > 0 ? LoadLanes(&batch.rows[y - 1][first]) : SetLanes(FULL_ROW_MASK);
+        sums[LANE_COLUMN_TRANSITIONS] = Add(sums[LANE_COLUMN_TRANSITIONS], CountByteBits(Xor(row, below)));
+
+        cover = Or(cover, row);
+        Lanes empty = IsZero(cover);
+        Lanes walledRow = Or(ShiftLeft(row, 1), walls);
+        Lanes walledCover = Or(ShiftLeft(cover, 1), walls);
+        Lanes rowTransitions = And(Xor(walledRow, ShiftRight(walledRow, 1)), SetLanes(WALLED_ROW_MASK));
+        Lanes wells = And(AndNot(cover, walledCover), And(ShiftRight(walledCover, 2), SetLanes(FULL_ROW_MASK)));
+
+        sums[LANE_MAX_HEIGHT] = Add(sums[LANE_MAX_HEIGHT], AndNot(empty, one));
+        sums[LANE_AGGREGATE_HEIGHT] = Add(sums[LANE_AGGREGATE_HEIGHT], CountByteBits(cover));
+        sums[LANE_HOLES] = Add(sums[LANE_HOLES], CountByteBits(AndNot(row, cover)));
+        sums[LANE_BUMPINESS] = Add(sums[LANE_BUMPINESS], CountByteBits(And(Xor(cover, ShiftRight(cover, 1)), SetLanes(FULL_ROW_MASK >> 1))));
+        sums[LANE_ROW_TRANSITIONS] = Add(sums[LANE_ROW_TRANSITIONS], CountByteBits(AndNot(empty, rowTransitions)));
+        sums[LANE_WELL_DEPTH] = Add(sums[LANE_WELL_DEPTH], CountByteBits(wells));
+
+        row = below;
+    }
+
+    // The height counter is a plain count, every other one is still split in bytes
+    for (uint32 i = 0; i < MAX_LANE_FEATURE; i++)
+        StoreLanes(&results[i][first], i == LANE_MAX_HEIGHT ? sums[i] : FoldBytes(sums[i]));
+}
+
+void EvaluateBoards(const BoardBatch& batch, BoardFeatures* features)
+{
+    alignas(32) uint16 results[MAX_LANE_FEATURE][BOARD_EVAL_BATCH];
+    for (uint32 first = 0; first < batch.count; first += LANES_PER_VECTOR)
+        EvaluateLanes(batch, first, results);
+
+    for (uint32 i = 0; i < batch.count; i++)
+    {
+        BoardFeatures& board = features[i];
+        board.aggregateHeight = results[LANE_AGGREGATE_HEIGHT][i];
+        board.maxHeight = results[LANE_MAX_HEIGHT][i];
+        board.holes = results[LANE_HOLES][i];
+        board.bumpiness = results[LANE_BUMPINESS][i];
+        board.rowTransitions = results[LANE_ROW_TRANSITIONS][i];
+        board.columnTransitions = results[LANE_COLUMN_TRANSITIONS][i];
+        board.wellDepth = results[LANE_WELL_DEPTH][i];
+    }
+}
+
+#else
+
+void EvaluateBoards(const BoardBatch& batch, BoardFeatures* features)
+{
+    EvaluateBoardsScalar(batch, features);
+}
+
+#endif
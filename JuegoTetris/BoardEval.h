@@ -0,0 +1,46 @@
+#ifndef BOARD_EVAL_H
+#define BOARD_EVAL_H
+
+#include "Common.h"
+#include "Board.h"
+
+// Boards scored together by EvaluateBoards, one 16 bit lane each: two SSE2 vectors or one AVX2 vector
+#define BOARD_EVAL_BATCH            16
+
+// Surface statistics of a board, the inputs of the bot evaluators
+struct BoardFeatures
+{
+    int32 aggregateHeight;      // Sum of the column heights
+    int32 maxHeight;
+    int32 holes;                // Empty cells under the top of their column
+    int32 bumpiness;            // Sum of the height differences between neighbour columns
+    int32 rowTransitions;       // Filled/empty changes along the rows under the top of the stack, walls count as filled
+    int32 columnTransitions;    // Filled/empty changes up the columns, the floor counts as filled
+    int32 wellDepth;            // Empty cells above their column with both neighbours (or a wall) higher
+};
+
+// Row masks of up to BOARD_EVAL_BATCH boards interleaved, so one load reads the same row of every board
+struct BoardBatch
+{
+    BoardBatch() { Clear(); }
+
+    void Clear();
+    // Copies the row masks of a board into the next lane, returns its index
+    uint32 Add(const uint16* rowMasks);
+
+    bool IsFull() const { return count == BOARD_EVAL_BATCH; }
+
+    alignas(32) uint16 rows[BOARD_HEIGHT][BOARD_EVAL_BATCH];
+    uint32 count;
+};
+
+// Features of one board from its row masks, BOARD_HEIGHT of them
+BoardFeatures EvaluateBoard(const uint16* rowMasks);
+
+// Features of every board of the batch, with SSE2 or AVX2 when the build targets them
+void EvaluateBoards(const BoardBatch& batch, BoardFeatures* features);
+
+// Same results one board at a time, always built, to compare against the vector kernels
+void EvaluateBoardsScalar(const BoardBatch& batch, BoardFeatures* features);
+
+#endif
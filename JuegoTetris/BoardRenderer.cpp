@@ -0,0 +1,436 @@
+#include "BoardRenderer.h"
+#include "Block.h"
+#include "Game.h"
+#include "Game3D.h"
+#include <cstddef>
+
+#define CUBE_VERTEX_COUNT   24
+#define CUBE_INDEX_COUNT    36
+#define CUBE_VERTEX_SIZE    5
+
+#define ATTRIB_POSITION         0
+#define ATTRIB_TEXCOORD         1
+#define ATTRIB_INSTANCE_OFFSET  2
+#define ATTRIB_INSTANCE_COLOR   3
+
+// Unit cube centered on the origin, x y z u v, same faces and winding as the immediate mode cube
+const GLfloat CUBE_VERTICES[CUBE_VERTEX_COUNT * CUBE_VERTEX_SIZE] =
+{
+    // Front
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+    // Back
+    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+     0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+    // Top
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    // Bottom
+    -0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+    // Right
+     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+    // Left
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+};
+
+const GLushort CUBE_INDICES[CUBE_INDEX_COUNT] =
+{
+     0,  1,  2,  0,  2,  3,
+     4,  5,  6,  4,  6,  7,
+     8,  9, 10,  8, 10, 11,
+    12, 13, 14, 12, 14, 15,
+    16, 17, 18, 16, 18, 19,
+    20, 21, 22, 20, 22, 23
+};
+
+const GLfloat COLORS[MAX_COLOR][4] =
+{
+    { 1.0f,   1.0f,   1.0f,   1.0f }, // COLOR_WHITE
+    { 0.0f,   0.0f,   0.0f,   1.0f }, // COLOR_BLACK
+    { 0.863f, 0.078f, 0.235f, 1.0f }, // COLOR_RED
+    { 0.118f, 0.565f, 1.000f, 1.0f }, // COLOR_BLUE
+    { 0.235f, 0.702f, 0.443f, 1.0f }, // COLOR_GREEN
+    { 1.0f,   1.0f,   0.0f,   1.0f }, // COLOR_YELLOW
+    { 0.902f, 0.902f, 0.980f, 1.0f }, // COLOR_CYAN
+    { 1.0f,   0.0f,   0.5f,   1.0f }, // COLOR_PINK
+    { 1.0f,   0.5f,   0.0f,   1.0f }, // COLOR_ORANGE
+    { 0.653f, 0.653f, 0.653f, 1.0f }  // COLOR_GRAY
+};
+
+// GLSL 1.20 so it runs on compatibility contexts, including Mesa llvmpipe. It reads the fixed function
+// lights and reproduces per vertex lighting of LIGHT0 and LIGHT1 and the GL_BLEND texture environment
+const char* CUBE_VERTEX_SHADER =
+    "#version 120\n"
+    "attribute vec3 position;\n"
+    "attribute vec2 texCoord;\n"
+    "attribute vec3 instanceOffset;\n"
+    "attribute vec4 instanceColor;\n"
+    "varying vec4 color;\n"
+    "varying vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 eyePosition = gl_ModelViewMatrix * vec4(position + instanceOffset, 1.0);\n"
+    // The immediate mode cubes never set a normal, so every face is lit as facing +z
+    "    vec3 normal = normalize(gl_NormalMatrix * vec3(0.0, 0.0, 1.0));\n"
+    "    vec3 lit = gl_LightModel.ambient.rgb * instanceColor.rgb;\n"
+    "    for (int i = 0; i < 2; i++)\n"
+    "    {\n"
+    "        vec3 toLight = gl_LightSource[i].position.xyz - eyePosition.xyz;\n"
+    "        float distance = length(toLight);\n"
+    "        float attenuation = 1.0 / (gl_LightSource[i].constantAttenuation + distance * (gl_LightSource[i].linearAttenuation + distance * gl_LightSource[i].quadraticAttenuation));\n"
+    "        float diffuse = max(dot(normal, toLight / distance), 0.0);\n"
+    "        lit += attenuation * (gl_LightSource[i].ambient.rgb + diffuse * gl_LightSource[i].diffuse.rgb) * instanceColor.rgb;\n"
+    "    }\n"
+    "    color = vec4(clamp(lit, 0.0, 1.0), instanceColor.a);\n"
+    "    uv = texCoord;\n"
+    "    gl_Position = gl_ProjectionMatrix * eyePosition;\n"
+    "}\n";
+
+const char* CUBE_FRAGMENT_SHADER =
+    "#version 120\n"
+    "uniform sampler2D cubeTexture;\n"
+    "varying vec4 color;\n"
+    "varying vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 texel = texture2D(cubeTexture, uv).rgb;\n"
+    "    gl_FragColor = vec4(mix(color.rgb, gl_TextureEnvColor[0].rgb, texel), color.a);\n"
+    "}\n";
+
+GLuint CompileShader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        char log[BUFFER_SIZE * 4];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        DEBUG_LOG("Shader compilation failed: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+BoardRenderer::BoardRenderer() : m_texture(0), m_vertexBuffer(0), m_indexBuffer(0), m_instanceBuffer(0), m_instanceCapacity(0),
+    m_uploadedCount(0), m_program(0), m_vertexAttribDivisor(nullptr), m_drawElementsInstanced(nullptr)
+{
+    m_instances.reserve(BOARD_WIDTH * BOARD_HEIGHT + 2 * NUM_BLOCK_SUBBLOCKS);
+}
+
+BoardRenderer::~BoardRenderer()
+{
+    // GL objects die with the context, Release has to be called while it is still current
+}
+
+bool BoardRenderer::Init(GLuint texture)
+{
+    Release();
+    m_texture = texture;
+
+    // Without buffer objects the mesh is drawn from client memory
+    if (!GLEW_VERSION_1_5)
+        return false;
+
+    glGenBuffers(1, &m_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &m_indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(CUBE_INDICES), CUBE_INDICES, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    if (!InitProgram())
+    {
+        DEBUG_LOG("Instanced rendering not available, drawing one cube per call\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool BoardRenderer::InitProgram()
+{
+    if (GLEW_VERSION_3_3)
+    {
+        m_vertexAttribDivisor = glVertexAttribDivisor;
+        m_drawElementsInstanced = glDrawElementsInstanced;
+    }
+    else if (GLEW_VERSION_2_0 && GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced)
+    {
+        m_vertexAttribDivisor = glVertexAttribDivisorARB;
+        m_drawElementsInstanced = glDrawElementsInstancedARB;
+    }
+    else
+        return false;
+
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, CUBE_VERTEX_SHADER);
+    GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, CUBE_FRAGMENT_SHADER);
+    if (!vertexShader || !fragmentShader)
+    {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, ATTRIB_POSITION, "position");
+    glBindAttribLocation(program, ATTRIB_TEXCOORD, "texCoord");
+    glBindAttribLocation(program, ATTRIB_INSTANCE_OFFSET, "instanceOffset");
+    glBindAttribLocation(program, ATTRIB_INSTANCE_COLOR, "instanceColor");
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char log[BUFFER_SIZE * 4];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        DEBUG_LOG("Shader link failed: %s\n", log);
+        glDeleteProgram(program);
+        return false;
+    }
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "cubeTexture"), 0);
+    glUseProgram(0);
+
+    glGenBuffers(1, &m_instanceBuffer);
+    m_program = program;
+    return true;
+}
+
+void BoardRenderer::Release()
+{
+    if (m_program)
+        glDeleteProgram(m_program);
+
+    if (m_vertexBuffer)
+        glDeleteBuffers(1, &m_vertexBuffer);
+
+    if (m_indexBuffer)
+        glDeleteBuffers(1, &m_indexBuffer);
+
+    if (m_instanceBuffer)
+        glDeleteBuffers(1, &m_instanceBuffer);
+
+    m_program = 0;
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_instanceBuffer = 0;
+    m_instanceCapacity = 0;
+    m_uploadedCount = 0;
+}
+
+const GLfloat* BoardRenderer::GetColor(uint8 color)
+{
+    return color < MAX_COLOR ? COLORS[color] : nullptr;
+}
+
+void BoardRenderer::Begin()
+{
+    m_instances.clear();
+    m_uploadedCount = 0;
+}
+
+void BoardRenderer::AddCube(GLfloat x, GLfloat y, GLfloat z, uint8 color)
+{
+    const GLfloat* rgba = GetColor(color);
+    if (!rgba)
+        return;
+
+    CubeInstance instance = { { x, y, z }, { rgba[0], rgba[1], rgba[2], rgba[3] } };
+    m_instances.push_back(instance);
+}
+
+void BoardRenderer::AddBlock(const Block* block)
+{
+    if (!block)
+        return;
+
+    GLfloat x = GLfloat(block->GetPositionX());
+    GLfloat y = GLfloat(block->GetPositionY());
+    for (SubBlock* sub : block->GetSubBlocks())
+        if (sub)
+            AddCube(x + GLfloat(sub->GetPositionX()), y + GLfloat(sub->GetPositionY()), 0.0f, block->GetColor());
+}
+
+void BoardRenderer::AddGame(const Game* game)
+{
+    AddBlock(game->GetActiveBlock());
+    AddBlock(game->GetNextBlock());
+
+    for (SubBlock* sub : game->GetSubBlockList())
+        AddCube(GLfloat(sub->GetPositionX()), GLfloat(sub->GetPositionY()), 0.0f, sub->GetColor());
+}
+
+void BoardRenderer::AddWell(const Game3D* game)
+{
+    const Well3D& well = game->GetWell();
+
+    // Floor of the well, one layer below the first
+    for (int32 z = 0; z < well.GetDepth(); z++)
+        for (int32 x = 0; x < well.GetWidth(); x++)
+            AddCube(GLfloat(x), -1.0f, -GLfloat(z), COLOR_GRAY);
+
+    for (int32 y = 0; y < well.GetLayerCount(); y++)
+    {
+        if (!well.GetLayerMask(y))
+            continue;
+
+        for (int32 z = 0; z < well.GetDepth(); z++)
+            for (int32 x = 0; x < well.GetWidth(); x++)
+                if (well.IsOccupied(x, y, z))
+                    AddCube(GLfloat(x), GLfloat(y), -GLfloat(z), well.GetCellColor(x, y, z));
+    }
+
+    if (game->HasActiveBlock())
+    {
+        Position3D position = game->GetActivePosition();
+        Color color = Block::GetColorByType(game->GetActiveType());
+        for (const Position3D& cell : GetBlockShape3D(game->GetActiveType(), game->GetActiveOrientation()).cells)
+            AddCube(GLfloat(position.x + cell.x), GLfloat(position.y + cell.y), -GLfloat(position.z + cell.z), color);
+    }
+
+    // Next block beside the well, flat and facing the viewer
+    BlockType next = game->GetNextType();
+    for (const Position3D& cell : GetBlockShape3D(next, 0).cells)
+        AddCube(GLfloat(well.GetWidth() + 2 + cell.x), GLfloat(well.GetHeight() - 2 + cell.y), 0.0f, Block::GetColorByType(next));
+}
+
+void BoardRenderer::Flush()
+{
+    Upload();
+    Draw();
+}
+
+void BoardRenderer::Upload()
+{
+    m_uploadedCount = GLsizei(m_instances.size());
+    if (!m_program || m_instances.empty())
+        return;
+
+    GLsizeiptr size = GLsizeiptr(m_instances.size() * sizeof(CubeInstance));
+
+    // Orphan the previous storage so the upload does not wait for the draw that used it
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    m_instanceCapacity = std::max(m_instanceCapacity, size);
+    glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BoardRenderer::Draw()
+{
+    if (!m_uploadedCount)
+        return;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
+
+    if (m_program)
+        DrawInstanced();
+    else
+        DrawFixedFunction();
+
+    glDisable(GL_TEXTURE_2D);
+}
+
+void BoardRenderer::DrawInstanced()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glVertexAttribPointer(ATTRIB_INSTANCE_OFFSET, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (const GLvoid*)offsetof(CubeInstance, offset));
+    glVertexAttribPointer(ATTRIB_INSTANCE_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (const GLvoid*)offsetof(CubeInstance, color));
+    glEnableVertexAttribArray(ATTRIB_INSTANCE_OFFSET);
+    glEnableVertexAttribArray(ATTRIB_INSTANCE_COLOR);
+    m_vertexAttribDivisor(ATTRIB_INSTANCE_OFFSET, 1);
+    m_vertexAttribDivisor(ATTRIB_INSTANCE_COLOR, 1);
+
+    GLsizei stride = CUBE_VERTEX_SIZE * sizeof(GLfloat);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)0);
+    glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(ATTRIB_POSITION);
+    glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+
+    glUseProgram(m_program);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    m_drawElementsInstanced(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_SHORT, (const GLvoid*)0, m_uploadedCount);
+    glUseProgram(0);
+
+    // Leave the attribute state as the fixed function code expects it
+    m_vertexAttribDivisor(ATTRIB_INSTANCE_OFFSET, 0);
+    m_vertexAttribDivisor(ATTRIB_INSTANCE_COLOR, 0);
+    glDisableVertexAttribArray(ATTRIB_POSITION);
+    glDisableVertexAttribArray(ATTRIB_TEXCOORD);
+    glDisableVertexAttribArray(ATTRIB_INSTANCE_OFFSET);
+    glDisableVertexAttribArray(ATTRIB_INSTANCE_COLOR);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BoardRenderer::DrawFixedFunction()
+{
+    // Offsets into the buffer objects when there are any, client memory otherwise
+    const GLubyte* vertices = m_vertexBuffer ? nullptr : (const GLubyte*)CUBE_VERTICES;
+    const GLubyte* indices = m_indexBuffer ? nullptr : (const GLubyte*)CUBE_INDICES;
+    GLsizei stride = CUBE_VERTEX_SIZE * sizeof(GLfloat);
+
+    if (m_vertexBuffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, vertices);
+    glTexCoordPointer(2, GL_FLOAT, stride, vertices + 3 * sizeof(GLfloat));
+    glNormal3f(0.0f, 0.0f, 1.0f);
+
+    for (GLsizei i = 0; i < m_uploadedCount; i++)
+    {
+        const CubeInstance& instance = m_instances[i];
+        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, instance.color);
+        glPushMatrix();
+        glTranslatef(instance.offset[0], instance.offset[1], instance.offset[2]);
+        glDrawElements(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_SHORT, indices);
+        glPopMatrix();
+    }
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    if (m_vertexBuffer)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
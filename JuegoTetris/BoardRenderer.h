@@ -0,0 +1,65 @@
+#ifndef BOARD_RENDERER_H
+#define BOARD_RENDERER_H
+
+#include "Common.h"
+#include <GL/glew.h>
+
+class Block;
+class Game;
+class Game3D;
+
+struct CubeInstance
+{
+    GLfloat offset[3];
+    GLfloat color[4];
+};
+
+// Draws every cube of a frame from one cube mesh uploaded once, with a single instanced draw call
+// when the context supports it and one glDrawElements per cube on older fixed function contexts
+class BoardRenderer
+{
+public:
+    BoardRenderer();
+    ~BoardRenderer();
+
+    bool Init(GLuint texture);
+    void Release();
+
+    void Begin();
+    void AddCube(GLfloat x, GLfloat y, GLfloat z, uint8 color);
+    void AddBlock(const Block* block);
+    void AddGame(const Game* game);
+    // Depth rows of the well go away from the viewer, along -z
+    void AddWell(const Game3D* game);
+    void Flush();
+
+    // Flush split in two, so a batch that does not change is uploaded once and drawn every frame
+    void Upload();
+    void Draw();
+
+    bool IsInstanced() const { return m_program != 0; }
+    uint32 GetCubeCount() const { return uint32(m_instances.size()); }
+
+    // Ambient and diffuse material color of each Color
+    static const GLfloat* GetColor(uint8 color);
+
+private:
+    bool InitProgram();
+    void DrawInstanced();
+    void DrawFixedFunction();
+
+    std::vector<CubeInstance> m_instances;
+
+    GLuint m_texture;
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+    GLuint m_instanceBuffer;
+    GLsizeiptr m_instanceCapacity;
+    GLsizei m_uploadedCount;
+    GLuint m_program;
+
+    PFNGLVERTEXATTRIBDIVISORPROC m_vertexAttribDivisor;
+    PFNGLDRAWELEMENTSINSTANCEDPROC m_drawElementsInstanced;
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include "Bot.h"
+#include "Profiler.h"
+#include "RolloutSearch.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include <cstring>
+
+void BotBoard::CopyFrom(const Board& board)
+{
+    for (int32 y = 0; y < BOARD_HEIGHT; y++)
+        rowMasks[y] = board.GetRowMask(y);
+}
+
+int32 BotBoard::GetStackHeight() const
+{
+    int32 y = BOARD_HEIGHT;
+    while (y > 0 && !rowMasks[y - 1])
+        y--;
+
+    return y;
+}
+
+bool BotBoard::Collides(const BlockShape& shape, int32 x, int32 y) const
+{
+    int32 left = x + shape.minX;
+    int32 bottom = y + shape.minY;
+    if (left < 0 || x + shape.maxX >= BOARD_WIDTH || bottom < 0)
+        return true;
+
+    for (int32 i = 0; i <= shape.maxY - shape.minY; i++)
+        if (GetRowMask(bottom + i) & (shape.rowMasks[i] << left))
+            return true;
+
+    return false;
+}
+
+uint32 BotBoard::Place(const BlockShape& shape, int32 x, int32 y)
+{
+    int32 left = x + shape.minX;
+    int32 bottom = y + shape.minY;
+    uint32 rows = 0;
+    for (int32 i = 0; i <= shape.maxY - shape.minY; i++)
+    {
+        if (bottom + i >= BOARD_HEIGHT)
+            break;
+
+        rowMasks[bottom + i] |= uint16(shape.rowMasks[i] << left);
+        if (rowMasks[bottom + i] == FULL_ROW_MASK)
+            rows |= 1u << (bottom + i);
+    }
+
+    if (!rows)
+        return 0;
+
+    int32 target = bottom;
+    for (int32 y = bottom; y < BOARD_HEIGHT; y++)
+        if (!(rows & (1u << y)))
+            rowMasks[target++] = rowMasks[y];
+
+    for (; target < BOARD_HEIGHT; target++)
+        rowMasks[target] = 0;
+
+    return CountBits(rows);
+}
+
+bool BotBoard::IsLost(BlockType next) const
+{
+    // Same checks as Game::CheckGameLost
+    if (GetRowMask(MAX_HEIGHT - 1) & (1 << CENTER))
+        return true;
+
+    return next != TYPE_NONE && Collides(GetBlockShape(next, 0), CENTER, MAX_HEIGHT);
+}
+
+BoardEvaluator MakeWeightedEvaluator(const EvaluatorWeights& weights /*= EvaluatorWeights()*/)
+{
+    return [weights](const BotBoard& /*board*/, const BoardFeatures& features, uint32 lines)
+    {
+        return weights.height * features.aggregateHeight + weights.lines * lines +
+            weights.holes * features.holes + weights.bumpiness * features.bumpiness +
+            weights.rowTransitions * features.rowTransitions + weights.columnTransitions * features.columnTransitions +
+            weights.wellDepth * features.wellDepth;
+    };
+}
+
+Bot::Bot(const BoardEvaluator& evaluator /*= MakeWeightedEvaluator()*/)
+{
+    m_evaluator = evaluator;
+    m_lookahead = true;
+    m_rollouts = nullptr;
+    m_table = nullptr;
+    m_planStep = 0;
+    m_planPiece = 0;
+    m_planType = TYPE_NONE;
+    m_expected = BotState();
+    m_evaluatedCount = 0;
+}
+
+const std::vector<Placement>& Bot::FindPlacements(const BotBoard& board, BlockType type, BotState start)
+{
+    Search(board, type, start, m_nodes, m_landings);
+    return m_landings;
+}
+
+void Bot::Search(const BotBoard& board, BlockType type, BotState start, std::vector<SearchNode>& nodes, std::vector<Placement>& landings,
+    bool fromSurface /*= false*/)
+{
+    nodes.clear();
+    landings.clear();
+    if (board.Collides(GetBlockShape(type, start.rotation), start.x, start.y))
+        return;
+
+    memset(m_visited, 0, sizeof(m_visited));
+
+    auto visit = [&](int32 x, int32 y, uint8 rotation, InputAction action, uint16 parent)
+    {
+        uint32 bit = 1u << (x + BOT_COLUMN_OFFSET);
+        if (m_visited[rotation][y] & bit)
+            return;
+
+        m_visited[rotation][y] |= bit;
+        if (!board.Collides(GetBlockShape(type, rotation), x, y))
+            nodes.push_back({ { int8(x), int8(y), rotation }, action, parent });
+    };
+
+    start.rotation %= NUM_ROTATIONS;
+    m_visited[start.rotation][start.y] |= 1u << (start.x + BOT_COLUMN_OFFSET);
+    nodes.push_back({ start, INPUT_NONE, 0 });
+
+    // Above the stack every column and rotation is open, so start from the lowest open row of each one instead of
+    // walking down to it. Every shape turns inside the board at the spawn column, so all of them are reachable
+    int32 surface = board.GetStackHeight();
+    uint8 rotations = type == TYPE_CUBE ? 1 : NUM_ROTATIONS;
+    for (uint8 rotation = 0; fromSurface && rotation < rotations; rotation++)
+        fromSurface = start.y + GetBlockShape(type, rotation).minY >= surface;
+
+    for (uint8 rotation = 0; fromSurface && rotation < rotations; rotation++)
+    {
+        const BlockShape& shape = GetBlockShape(type, rotation);
+        int32 y = surface - shape.minY;
+        uint32 columns = 0;
+        for (int32 x = -shape.minX; x + shape.maxX < BOARD_WIDTH; x++)
+        {
+            columns |= 1u << (x + BOT_COLUMN_OFFSET);
+            nodes.push_back({ { int8(x), int8(y), rotation }, INPUT_NONE, 0 });
+        }
+
+        // The open rows above are covered by the new starting states
+        for (; y < BOARD_HEIGHT; y++)
+            m_visited[rotation][y] |= columns;
+    }
+
+    // Breadth first, so each state keeps the shortest way to reach it with rotations and side moves
+    // tried before soft drops
+    for (uint32 i = 0; i < nodes.size(); i++)
+    {
+        BotState state = nodes[i].state;
+        uint16 parent = uint16(i);
+
+        // Cube should not rotate
+        if (type != TYPE_CUBE)
+            visit(state.x, state.y, uint8((state.rotation + 1) % NUM_ROTATIONS), INPUT_ROTATE, parent);
+
+        visit(state.x - 1, state.y, state.rotation, INPUT_MOVE_LEFT, parent);
+        visit(state.x + 1, state.y, state.rotation, INPUT_MOVE_RIGHT, parent);
+
+        if (board.Collides(GetBlockShape(type, state.rotation), state.x, state.y - 1))
+            landings.push_back({ state, parent });
+        else
+            visit(state.x, state.y - 1, state.rotation, INPUT_SOFT_DROP, parent);
+    }
+}
+
+float Bot::ScorePlacement(const BotBoard& board, BlockType type, const Placement& placement, BlockType next)
+{
+    BotBoard placed = board;
+    uint32 lines = placed.Place(GetBlockShape(type, placement.state.rotation), placement.state.x, placement.state.y);
+    if (placed.IsLost(next))
+        return BOT_LOST_SCORE;
+
+    if (!m_lookahead || next == TYPE_NONE)
+        return Evaluate(placed, lines);
+
+    BotState nextState;
+    return FindBest(placed, next, lines, nextState);
+}
+
+float Bot::PlaceBest(BotBoard& board, BlockType type, uint32& lines)
+{
+    BotState state;
+    float best = FindBest(board, type, 0, state);
+    if (best != BOT_LOST_SCORE)
+        lines = board.Place(GetBlockShape(type, state.rotation), state.x, state.y);
+
+    return best;
+}
+
+// Table data: score bits in the high half, the landing in the low bytes
+static uint64 PackResult(float score, const BotState& state)
+{
+    uint32 bits;
+    memcpy(&bits, &score, sizeof(bits));
+    return (uint64(bits) << 32) | (uint64(state.rotation) << 16) | (uint64(uint8(state.y)) << 8) | uint64(uint8(state.x));
+}
+
+static float UnpackResult(uint64 data, BotState& state)
+{
+    state.x = int8(data & 0xFF);
+    state.y = int8((data >> 8) & 0xFF);
+    state.rotation = uint8((data >> 16) & 0xFF);
+
+    uint32 bits = uint32(data >> 32);
+    float score;
+    memcpy(&score, &bits, sizeof(score));
+    return score;
+}
+
+float Bot::FindBest(const BotBoard& board, BlockType type, uint32 lines, BotState& bestState)
+{
+    // Rollouts and lookaheads keep meeting the same boards, the result only depends on the board, the block
+    // and the rows already removed
+    uint64 key = 0;
+    if (m_table)
+    {
+        uint64 data;
+        key = HashRowMasks(board.rowMasks) ^ GetZobristActiveKey(type) ^ GetZobristLinesKey(lines);
+        if (m_table->Probe(key, data))
+            return UnpackResult(data, bestState);
+    }
+
+    // Blocks always spawn unrotated at the top center
+    float best = BOT_LOST_SCORE;
+    bestState = BotState();
+    Search(board, type, { CENTER, MAX_HEIGHT, 0 }, m_nextNodes, m_nextLandings, true);
+    for (const Placement& landing : m_nextLandings)
+    {
+        BotBoard& placed = m_batchBoards[m_batch.count];
+        placed = board;
+        uint32 placedLines = placed.Place(GetBlockShape(type, landing.state.rotation), landing.state.x, landing.state.y);
+        if (placed.IsLost(TYPE_NONE))
+            continue;
+
+        m_batchStates[m_batch.count] = landing.state;
+        m_batchLines[m_batch.Add(placed.rowMasks)] = lines + placedLines;
+        if (m_batch.IsFull())
+            ScoreBatch(best, bestState);
+    }
+    ScoreBatch(best, bestState);
+
+    if (m_table)
+        m_table->Store(key, PackResult(best, bestState));
+
+    return best;
+}
+
+void Bot::ScoreBatch(float& best, BotState& bestState)
+{
+    EvaluateBoards(m_batch, m_batchFeatures);
+    for (uint32 i = 0; i < m_batch.count; i++)
+    {
+        float score = m_evaluator(m_batchBoards[i], m_batchFeatures[i], m_batchLines[i]);
+        if (score > best)
+        {
+            best = score;
+            bestState = m_batchStates[i];
+        }
+    }
+
+    m_evaluatedCount += m_batch.count;
+    m_batch.count = 0;
+}
+
+bool Bot::Plan(const Game& game)
+{
+    PROFILE_SCOPE("Bot::Plan");
+
+    m_plan.clear();
+    m_planStep = 0;
+
+    const Block* active = game.GetActiveBlock();
+    if (!active || game.IsGameOver())
+        return false;
+
+    BotBoard board;
+    board.CopyFrom(game.GetBoard());
+
+    BlockType type = active->GetType();
+    BotState start = { active->GetPositionX(), active->GetPositionY(), active->GetRotation() };
+    const Block* nextBlock = game.GetNextBlock();
+    BlockType next = nextBlock ? nextBlock->GetType() : TYPE_NONE;
+
+    Search(board, type, start, m_nodes, m_landings);
+    if (m_landings.empty())
+        return false;
+
+    // Losing placements are still played when there is nothing else
+    uint32 bestIndex = 0;
+    m_scores.clear();
+    for (uint32 i = 0; i < m_landings.size(); i++)
+    {
+        m_scores.push_back(ScorePlacement(board, type, m_landings[i], next));
+        if (m_scores[i] > m_scores[bestIndex])
+            bestIndex = i;
+    }
+
+    if (m_rollouts)
+        bestIndex = m_rollouts->Choose(board, type, next, game.GetPieceGenerator().GetPolicy(), m_landings, m_scores);
+
+    const Placement* best = &m_landings[bestIndex];
+
+    for (uint16 node = best->node; node != 0; node = m_nodes[node].parent)
+        m_plan.push_back({ m_nodes[node].action, m_nodes[node].state });
+    std::reverse(m_plan.begin(), m_plan.end());
+
+    // The hard drop covers the soft drops at the end of the path
+    while (!m_plan.empty() && m_plan.back().action == INPUT_SOFT_DROP)
+        m_plan.pop_back();
+    m_plan.push_back({ INPUT_HARD_DROP, best->state });
+
+    m_planPiece = game.GetPiecesPlaced();
+    m_planType = type;
+    m_expected = start;
+    return true;
+}
+
+InputAction Bot::GetNextAction(const Game& game)
+{
+    const Block* active = game.GetActiveBlock();
+    if (!active || game.IsGameOver())
+        return INPUT_NONE;
+
+    // Gravity, a block change or any other input invalidate the plan
+    BotState current = { active->GetPositionX(), active->GetPositionY(), active->GetRotation() };
+    if (m_planStep >= m_plan.size() || m_planPiece != game.GetPiecesPlaced() || m_planType != active->GetType() || m_expected != current)
+    {
+        if (!Plan(game))
+            return INPUT_NONE;
+    }
+
+    const PlanStep& step = m_plan[m_planStep++];
+    m_expected = step.state;
+    return step.action;
+}
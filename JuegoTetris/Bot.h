@@ -0,0 +1,166 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "Common.h"
+#include "Board.h"
+#include "BoardEval.h"
+#include "Game.h"
+#include <functional>
+#include <limits>
+
+// Shift of the visited masks, so a block origin left of the board still has a bit
+#define BOT_COLUMN_OFFSET           2
+
+// Score of a placement that ends the game, below anything the evaluator returns
+#define BOT_LOST_SCORE              std::numeric_limits<float>::lowest()
+
+class RolloutSearch;
+class TranspositionTable;
+
+// Row masks of a board without the SubBlock plane, cheap to copy for every candidate placement
+struct BotBoard
+{
+    void CopyFrom(const Board& board);
+
+    uint16 GetRowMask(int32 y) const { return (y >= 0 && y < BOARD_HEIGHT) ? rowMasks[y] : 0; }
+    // Number of rows up to the highest filled cell
+    int32 GetStackHeight() const;
+
+    // Same rules as Board::Collides
+    bool Collides(const BlockShape& shape, int32 x, int32 y) const;
+    // Locks the shape and removes the full rows, returns the number of rows removed
+    uint32 Place(const BlockShape& shape, int32 x, int32 y);
+    // True if the game would end with this board, next is the block that spawns on it (TYPE_NONE if unknown)
+    bool IsLost(BlockType next) const;
+
+    BoardFeatures GetFeatures() const { return EvaluateBoard(rowMasks); }
+
+    uint16 rowMasks[BOARD_HEIGHT];
+};
+
+// Scores a board after a placement that removed the given number of rows, higher is better.
+// The features of the board come already computed, usually in batches
+typedef std::function<float(const BotBoard& board, const BoardFeatures& features, uint32 lines)> BoardEvaluator;
+
+struct EvaluatorWeights
+{
+    float height            = -0.510066f;
+    float lines             =  0.760666f;
+    float holes             = -0.35663f;
+    float bumpiness         = -0.184483f;
+    float rowTransitions    = 0.0f;
+    float columnTransitions = 0.0f;
+    float wellDepth         = 0.0f;
+};
+
+BoardEvaluator MakeWeightedEvaluator(const EvaluatorWeights& weights = EvaluatorWeights());
+
+struct BotState
+{
+    int8 x, y;
+    uint8 rotation;
+
+    inline bool operator==(const BotState& other) const { return x == other.x && y == other.y && rotation == other.rotation; }
+    inline bool operator!=(const BotState& other) const { return !(*this == other); }
+};
+
+// Resting place of a block and the search node that reaches it
+struct Placement
+{
+    BotState state;
+    uint16 node;
+};
+
+// Built in player: finds every landing the active block can reach with the game moves, scores it with
+// the best landing of the next block and plays the moves of the best one
+class Bot
+{
+public:
+    Bot(const BoardEvaluator& evaluator = MakeWeightedEvaluator());
+
+    void SetEvaluator(const BoardEvaluator& evaluator) { m_evaluator = evaluator; }
+
+    // Scores the placements of the active block alone, without the next one
+    void SetLookahead(bool lookahead) { m_lookahead = lookahead; }
+    bool GetLookahead() const { return m_lookahead; }
+
+    // Lets the rollouts choose between the best placements, nullptr to go back to the plain search
+    void SetRolloutSearch(RolloutSearch* rollouts) { m_rollouts = rollouts; }
+    RolloutSearch* GetRolloutSearch() const { return m_rollouts; }
+
+    // Keeps the best landing of every board and block scored in the table and looks it up before searching
+    // again. Only bots with the same evaluator can share a table, nullptr searches every time
+    void SetTranspositionTable(TranspositionTable* table) { m_table = table; }
+    TranspositionTable* GetTranspositionTable() const { return m_table; }
+
+    // Every landing reachable from start with moves, rotations and soft drops, in breadth first order
+    const std::vector<Placement>& FindPlacements(const BotBoard& board, BlockType type, BotState start);
+
+    float Evaluate(const BotBoard& board, uint32 lines) { m_evaluatedCount++; return m_evaluator(board, board.GetFeatures(), lines); }
+
+    // Greedy move of the rollouts: spawns the block and places it where the evaluator scores best, without
+    // lookahead. Returns the score, or BOT_LOST_SCORE leaving the board as it was when every placement loses
+    float PlaceBest(BotBoard& board, BlockType type, uint32& lines);
+
+    // Picks the best placement for the active block and the moves to reach it, false if there is none
+    bool Plan(const Game& game);
+
+    // Next input of the plan, planning again when the active block is not where the plan expects it
+    InputAction GetNextAction(const Game& game);
+
+    // Boards scored since the bot was created
+    uint64 GetEvaluatedCount() const { return m_evaluatedCount; }
+
+private:
+    struct SearchNode
+    {
+        BotState state;
+        InputAction action;
+        uint16 parent;
+    };
+
+    struct PlanStep
+    {
+        InputAction action;
+        BotState state;
+    };
+
+    // With fromSurface the open rows above the stack are skipped, the nodes then hold no path from start
+    void Search(const BotBoard& board, BlockType type, BotState start, std::vector<SearchNode>& nodes, std::vector<Placement>& landings,
+        bool fromSurface = false);
+    float ScorePlacement(const BotBoard& board, BlockType type, const Placement& placement, BlockType next);
+    // Best landing of the block spawned on the board, scored with the rows already removed added to its own.
+    // Returns BOT_LOST_SCORE when every landing loses
+    float FindBest(const BotBoard& board, BlockType type, uint32 lines, BotState& bestState);
+    // Scores the boards waiting in the batch and empties it, keeping the best one when it beats best
+    void ScoreBatch(float& best, BotState& bestState);
+
+    BoardEvaluator m_evaluator;
+    bool m_lookahead;
+    RolloutSearch* m_rollouts;
+    TranspositionTable* m_table;
+
+    std::vector<SearchNode> m_nodes;
+    std::vector<Placement> m_landings;
+    std::vector<float> m_scores;
+    std::vector<SearchNode> m_nextNodes;
+    std::vector<Placement> m_nextLandings;
+    uint32 m_visited[NUM_ROTATIONS][BOARD_HEIGHT];
+
+    // Lookahead boards waiting to be scored together
+    BoardBatch m_batch;
+    BotBoard m_batchBoards[BOARD_EVAL_BATCH];
+    BotState m_batchStates[BOARD_EVAL_BATCH];
+    uint32 m_batchLines[BOARD_EVAL_BATCH];
+    BoardFeatures m_batchFeatures[BOARD_EVAL_BATCH];
+
+    std::vector<PlanStep> m_plan;
+    uint32 m_planStep;
+    uint32 m_planPiece;
+    BlockType m_planType;
+    BotState m_expected;
+
+    uint64 m_evaluatedCount;
+};
+
+#endif
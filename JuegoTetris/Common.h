@@ -1,11 +1,5 @@
-#ifdef _WIN32
-#include <Windows.h>
-#include <mmsystem.h>
-#define PlaySoundTetris PlaySound
-#undef max
-#else
-#define PlaySoundCustom
-#endif //_WIN32
+#ifndef COMMON_H
+#define COMMON_H
 
 #include <cstdio>
 #include <math.h>
@@ -16,13 +10,17 @@
 #include <stdlib.h>
 #include <string>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #define _USE_MATH_DEFINES
 
-#define MAX_HEIGHT                  15.0f
-#define MAX_WIDTH                   10.0f
-#define CENTER                      4.0f
-#define NEXT_BLOCK_X                15.0f
-#define NEXT_BLOCK_Y                8.0f
+#define MAX_HEIGHT                  15
+#define MAX_WIDTH                   10
+#define CENTER                      4
+#define NEXT_BLOCK_X                15
+#define NEXT_BLOCK_Y                8
 #define DISPLAY_NEXT_BLOCK_X        12.0f
 #define DISPLAY_NEXT_BLOCK_Y        5.0f
 #define DISPLAY_NEXT_BLOCK_HEIGHT   8.0f
@@ -41,10 +39,34 @@
     #define DEBUG_LOG(fmt, ...)
 #endif
 
-typedef signed short        int8;
+typedef signed char         int8;
+typedef signed short        int16;
 typedef signed int          int32;
 typedef signed long long    int64;
 
-typedef unsigned short      uint8;
+typedef unsigned char       uint8;
+typedef unsigned short      uint16;
 typedef unsigned int        uint32;
 typedef unsigned long long  uint64;
+
+inline uint32 CountBits(uint32 value)
+{
+#ifdef _MSC_VER
+    return __popcnt(value);
+#else
+    return uint32(__builtin_popcount(value));
+#endif
+}
+
+inline uint32 CountTrailingZeros(uint32 value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return uint32(index);
+#else
+    return uint32(__builtin_ctz(value));
+#endif
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "FrameCapture.h"
+#include "RgbImage.h"
+#include <cstring>
+
+FrameCapture::FrameCapture()
+{
+    m_format            = CAPTURE_BMP;
+    m_stream            = nullptr;
+    m_width             = 0;
+    m_height            = 0;
+    m_rowSize           = 0;
+    m_isCapturing       = false;
+    m_usePixelBuffers   = false;
+    m_issuedFrames      = 0;
+    m_collectedFrames   = 0;
+    m_capturedFrames    = 0;
+    m_droppedFrames     = 0;
+    m_stopping          = false;
+    memset(m_pixelBuffers, 0, sizeof(m_pixelBuffers));
+}
+
+FrameCapture::~FrameCapture()
+{
+    Stop();
+}
+
+bool FrameCapture::Start(const char* path, CaptureFormat format, int32 width, int32 height, uint32 framesPerSecond)
+{
+    Stop();
+
+    // 4:2:0 chroma needs even sizes
+    if (format == CAPTURE_Y4M)
+    {
+        width &= ~1;
+        height &= ~1;
+    }
+
+    if (width <= 0 || height <= 0)
+        return false;
+
+    m_format = format;
+    m_path = path;
+    m_width = width;
+    m_height = height;
+    m_rowSize = ((3 * width + 3) >> 2) << 2;
+
+    if (format == CAPTURE_Y4M)
+    {
+        m_stream = fopen(path, "wb");
+        if (!m_stream)
+        {
+            DEBUG_LOG("Failed to open capture stream %s\n", path);
+            return false;
+        }
+
+        fprintf(m_stream, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+        m_yuv.resize(size_t(width) * height * 3 / 2);
+    }
+
+    m_usePixelBuffers = GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+    if (m_usePixelBuffers)
+    {
+        glGenBuffers(CAPTURE_RING_SIZE, m_pixelBuffers);
+        for (GLuint buffer : m_pixelBuffers)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(m_rowSize) * height, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    m_issuedFrames = 0;
+    m_collectedFrames = 0;
+    m_capturedFrames = 0;
+    m_droppedFrames = 0;
+    m_stopping = false;
+    m_writer = std::thread(&FrameCapture::WriterLoop, this);
+    m_isCapturing = true;
+    return true;
+}
+
+void FrameCapture::Stop()
+{
+    if (!m_isCapturing)
+        return;
+
+    // Frames still in the ring are collected before the writer is told to finish
+    while (m_collectedFrames < m_issuedFrames)
+        CollectFrame(m_collectedFrames % CAPTURE_RING_SIZE);
+
+    if (m_usePixelBuffers)
+        glDeleteBuffers(CAPTURE_RING_SIZE, m_pixelBuffers);
+    memset(m_pixelBuffers, 0, sizeof(m_pixelBuffers));
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeCondition.notify_all();
+    m_writer.join();
+
+    if (m_stream)
+        fclose(m_stream);
+    m_stream = nullptr;
+    m_isCapturing = false;
+}
+
+void FrameCapture::CaptureFrame()
+{
+    if (!m_isCapturing)
+        return;
+
+    GLint oldAlignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &oldAlignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    if (!m_usePixelBuffers)
+    {
+        // No pixel buffers, the read blocks but the disk work still happens on the writer
+        std::vector<unsigned char> pixels(size_t(m_rowSize) * m_height);
+        glReadPixels(0, 0, m_width, m_height, GL_BGR, GL_UNSIGNED_BYTE, pixels.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, oldAlignment);
+        QueueFrame(pixels.data());
+        return;
+    }
+
+    // The slot about to be reused holds the oldest read, by now it has long finished on the GPU
+    uint32 slot = m_issuedFrames % CAPTURE_RING_SIZE;
+    if (m_issuedFrames - m_collectedFrames == CAPTURE_RING_SIZE)
+        CollectFrame(slot);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[slot]);
+    glReadPixels(0, 0, m_width, m_height, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, oldAlignment);
+    m_issuedFrames++;
+
+    // Collect as soon as a read is CAPTURE_RING_SIZE - 1 frames old, the writer gets frames with little delay
+    if (m_issuedFrames - m_collectedFrames == CAPTURE_RING_SIZE)
+        CollectFrame(m_collectedFrames % CAPTURE_RING_SIZE);
+}
+
+void FrameCapture::CollectFrame(uint32 slot)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[slot]);
+    if (const unsigned char* pixels = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY))
+    {
+        QueueFrame(pixels);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_collectedFrames++;
+}
+
+void FrameCapture::QueueFrame(const unsigned char* pixels)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // A slow disk drops frames instead of slowing down the game
+    if (m_queue.size() >= CAPTURE_MAX_QUEUED)
+    {
+        m_droppedFrames++;
+        return;
+    }
+
+    FrameData frame;
+    if (!m_freeFrames.empty())
+    {
+        frame.swap(m_freeFrames.back());
+        m_freeFrames.pop_back();
+    }
+
+    // The copy is made outside the lock, only the owner thread touches a frame it holds
+    lock.unlock();
+    frame.assign(pixels, pixels + size_t(m_rowSize) * m_height);
+    lock.lock();
+
+    m_queue.push_back(std::move(frame));
+    m_wakeCondition.notify_one();
+}
+
+void FrameCapture::WriterLoop()
+{
+    uint32 index = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wakeCondition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty())
+            return;
+
+        FrameData frame = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        lock.unlock();
+        bool written = WriteFrame(frame, index++);
+        lock.lock();
+
+        if (written)
+            m_capturedFrames++;
+        else
+            m_droppedFrames++;
+
+        m_freeFrames.push_back(std::move(frame));
+    }
+}
+
+bool FrameCapture::WriteFrame(const FrameData& frame, uint32 index)
+{
+    if (m_format == CAPTURE_BMP)
+    {
+        // GL rows are bottom up BGR with four byte alignment, which is the BMP layout
+        char filename[FILENAME_MAX];
+        snprintf(filename, sizeof(filename), "%s%06u.bmp", m_path.c_str(), index);
+        return RgbImage::WriteBgrBmpFile(filename, m_height, m_width, frame.data());
+    }
+
+    WriteY4mFrame(frame);
+    return fputs("FRAME\n", m_stream) >= 0 && fwrite(m_yuv.data(), 1, m_yuv.size(), m_stream) == m_yuv.size();
+}
+
+void FrameCapture::WriteY4mFrame(const FrameData& frame)
+{
+    // Full range BT.601 (C420jpeg), one chroma sample per 2x2 block, rows flipped to top down
+    unsigned char* yPlane = m_yuv.data();
+    unsigned char* uPlane = yPlane + size_t(m_width) * m_height;
+    unsigned char* vPlane = uPlane + size_t(m_width / 2) * (m_height / 2);
+
+    for (int32 y = 0; y < m_height; y += 2)
+    {
+        const unsigned char* rows[2] = { &frame[size_t(m_height - 1 - y) * m_rowSize], &frame[size_t(m_height - 2 - y) * m_rowSize] };
+        for (int32 x = 0; x < m_width; x += 2)
+        {
+            int32 sumR = 0, sumG = 0, sumB = 0;
+            for (int32 i = 0; i < 2; i++)
+            {
+                for (int32 j = 0; j < 2; j++)
+                {
+                    const unsigned char* pixel = rows[i] + 3 * (x + j);
+                    int32 b = pixel[0], g = pixel[1], r = pixel[2];
+                    yPlane[size_t(y + i) * m_width + x + j] = (unsigned char)((77 * r + 150 * g + 29 * b + 128) >> 8);
+                    sumR += r;
+                    sumG += g;
+                    sumB += b;
+                }
+            }
+
+            // Sums of four pixels, the extra >> 2 averages them
+            size_t chroma = size_t(y / 2) * (m_width / 2) + x / 2;
+            uPlane[chroma] = (unsigned char)std::min(255, (-43 * sumR - 85 * sumG + 128 * sumB + 4 * 32896) >> 10);
+            vPlane[chroma] = (unsigned char)std::min(255, (128 * sumR - 107 * sumG - 21 * sumB + 4 * 32896) >> 10);
+        }
+    }
+}
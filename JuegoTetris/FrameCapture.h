@@ -0,0 +1,78 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "Common.h"
+#include <GL/glew.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Frames in flight between glReadPixels and the map that collects them
+#define CAPTURE_RING_SIZE       3
+// Frames waiting for the writer before new ones are dropped
+#define CAPTURE_MAX_QUEUED      8
+
+enum CaptureFormat : uint8
+{
+    CAPTURE_BMP,        // One numbered BMP file per frame
+    CAPTURE_Y4M         // Single raw YUV 4:2:0 stream
+};
+
+// Reads frames back through a ring of pixel buffer objects, so the read of frame n is collected
+// CAPTURE_RING_SIZE - 1 frames later without stalling, and streams them to disk on a writer thread
+class FrameCapture
+{
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Captures the width x height bottom left corner of the framebuffer. For BMP the path is the
+    // prefix of the numbered files, for Y4M the stream file
+    bool Start(const char* path, CaptureFormat format, int32 width, int32 height, uint32 framesPerSecond);
+    void Stop();
+
+    // After the frame is drawn and before the buffers are swapped
+    void CaptureFrame();
+
+    bool IsCapturing() const { return m_isCapturing; }
+    uint32 GetCapturedFrames() const { return m_capturedFrames; }
+    uint32 GetDroppedFrames() const { return m_droppedFrames; }
+
+private:
+    typedef std::vector<unsigned char> FrameData;
+
+    void CollectFrame(uint32 slot);
+    void QueueFrame(const unsigned char* pixels);
+    void WriterLoop();
+    bool WriteFrame(const FrameData& frame, uint32 index);
+    void WriteY4mFrame(const FrameData& frame);
+
+    CaptureFormat m_format;
+    std::string m_path;
+    FILE* m_stream;
+    int32 m_width;
+    int32 m_height;
+    int32 m_rowSize;
+    bool m_isCapturing;
+    bool m_usePixelBuffers;
+
+    GLuint m_pixelBuffers[CAPTURE_RING_SIZE];
+    uint32 m_issuedFrames;
+    uint32 m_collectedFrames;
+    uint32 m_capturedFrames;
+    uint32 m_droppedFrames;
+
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::deque<FrameData> m_queue;
+    std::vector<FrameData> m_freeFrames;
+    std::vector<unsigned char> m_yuv;
+    bool m_stopping;
+};
+
+#endif
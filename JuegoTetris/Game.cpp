@@ -1,26 +1,36 @@
 #include "Game.h"
+#include "Profiler.h"
+#include "Replay.h"
+#include "Zobrist.h"
 
 Game::Game()
 {
     m_level             = 0;
     m_points            = 0;
     m_currentBlockId    = 0;
-    m_nextMoveTime      = 0;
-    m_pausedTime        = 0;
+    m_tick              = 0;
+    m_nextDropTick      = 0;
     m_linesCompleted    = 0;
+    m_lastClearedRows   = 0;
+    m_piecesPlaced      = 0;
+    m_events            = EVENT_NONE;
     m_activeBlock       = nullptr;
     m_nextBlock         = nullptr;
-    m_lastBlockType     = TYPE_NONE;
+    m_blockHash         = 0;
+    m_recorder          = nullptr;
     m_isPaused          = false;
+    m_isGameOver        = false;
     m_gameBlocks.clear();
+    m_gameBlocks.reserve(BOARD_WIDTH * BOARD_HEIGHT);
+    m_board.Clear();
 }
 
 Game::~Game()
 {
-    m_gameBlocks.clear();
+    ReleaseAllBlocks();
 }
 
-Game* Game::CreateNewGame(uint32 level /*=DEFAULT_LEVEL*/)
+Game* Game::CreateNewGame(uint32 level /*=DEFAULT_LEVEL*/, uint64 seed /*=DEFAULT_SEED*/, GeneratorPolicy policy /*=GENERATOR_NO_REPEAT*/)
 {
     Game* newGame = new Game();
     if (!newGame)
@@ -31,62 +41,172 @@ Game* Game::CreateNewGame(uint32 level /*=DEFAULT_LEVEL*/)
 
     DEBUG_LOG("Game succesfully created.\n");
 
-    newGame->m_level = level;
-    newGame->m_points = 0;
-    newGame->m_gameBlocks.clear();
-    newGame->m_nextMoveTime = newGame->GetNextMoveTime();
+    newGame->ResetGame(level, seed, policy);
 
     return newGame;
 }
 
+void Game::ResetGame(uint32 level /*=DEFAULT_LEVEL*/, uint64 seed /*=DEFAULT_SEED*/, GeneratorPolicy policy /*=GENERATOR_NO_REPEAT*/)
+{
+    ReleaseAllBlocks();
+
+    m_level             = level;
+    m_points            = 0;
+    m_linesCompleted    = 0;
+    m_currentBlockId    = 0;
+    m_tick              = 0;
+    m_isPaused          = false;
+    m_isGameOver        = false;
+    m_lastClearedRows   = 0;
+    m_piecesPlaced      = 0;
+    m_events            = EVENT_STATE_CHANGED;
+    m_generator.Reset(seed, policy);
+    m_nextDropTick      = GetDropInterval();
+
+    if (m_recorder)
+        m_recorder->Begin(level, seed, policy);
+}
+
+void Game::SetRecorder(ReplayRecorder* recorder)
+{
+    m_recorder = recorder;
+    if (m_recorder)
+        m_recorder->Begin(m_level, m_generator.GetSeed(), m_generator.GetPolicy());
+}
+
+void Game::ReleaseBlock(Block* block)
+{
+    if (!block)
+        return;
+
+    for (SubBlock* sub : block->GetSubBlocks())
+        ReleaseSubBlock(sub);
+
+    m_blockPool.Destroy(block);
+}
+
+SubBlock* Game::PlaceSubBlock(int32 x, int32 y, Color color)
+{
+    if (!Board::IsInside(x, y) || m_board.IsOccupied(x, y))
+        return nullptr;
+
+    SubBlock* sub = CreateSubBlock();
+    sub->SetPosition(Position(int8(x), int8(y)));
+    sub->SetColor(color);
+    m_gameBlocks.push_back(sub);
+    m_board.SetSubBlock(x, y, sub);
+    return sub;
+}
+
+void Game::ReleaseAllBlocks()
+{
+    ReleaseBlock(m_activeBlock);
+    ReleaseBlock(m_nextBlock);
+    m_activeBlock = nullptr;
+    m_nextBlock = nullptr;
+
+    for (SubBlock* sub : m_gameBlocks)
+        ReleaseSubBlock(sub);
+
+    m_gameBlocks.clear();
+    m_board.Clear();
+    m_blockHash = 0;
+}
+
 void Game::StartGame()
 {
     GenerateBlock(true);
     GenerateBlock(false);
 }
 
-void Game::Update()
+void Game::Step(uint32 ticks /*= 1*/)
 {
-    if (int64(m_nextMoveTime - clock()) <= 0)
+    PROFILE_SCOPE("Game::Step");
+
+    if (m_isPaused || m_isGameOver)
+        return;
+
+    uint64 targetTick = m_tick + ticks;
+    while (m_nextDropTick <= targetTick)
     {
         //DebugBlockPositions();
-        m_nextMoveTime = GetNextMoveTime();
+        m_tick = m_nextDropTick;
+        m_nextDropTick = m_tick + GetDropInterval();
         HandleDropBlock();
+
+        if (m_isGameOver)
+            return;
+    }
+
+    m_tick = targetTick;
+}
+
+void Game::ApplyInput(InputAction action)
+{
+    if (m_isPaused || m_isGameOver)
+        return;
+
+    if (m_recorder)
+        m_recorder->Record(m_tick, ReplayCode(action));
+
+    switch (action)
+    {
+    case INPUT_MOVE_LEFT:
+        MoveBlock(false);
+        break;
+    case INPUT_MOVE_RIGHT:
+        MoveBlock(true);
+        break;
+    case INPUT_ROTATE:
+        RotateActiveBlock();
+        break;
+    case INPUT_SOFT_DROP:
+        IncreaseBlockSpeed();
+        break;
+    case INPUT_HARD_DROP:
+        DropBlock();
+        break;
+    case INPUT_CHANGE_BLOCK:
+        ChangeBlock();
+        break;
+    default:
+        break;
     }
 }
 
 void Game::PauseGame()
 {
-    //m_pausedTime = clock();
+    m_isPaused = true;
+    RaiseEvent(EVENT_STATE_CHANGED);
+
+    if (m_recorder)
+        m_recorder->Record(m_tick, REPLAY_PAUSE);
 }
 
 void Game::ResumeGame()
 {
-    m_nextMoveTime = GetNextMoveTime();
+    m_isPaused = false;
+    m_nextDropTick = m_tick + GetDropInterval();
+    RaiseEvent(EVENT_STATE_CHANGED);
+
+    if (m_recorder)
+        m_recorder->Record(m_tick, REPLAY_RESUME);
 }
 
 Block* Game::GenerateBlock(bool active, BlockType type /*= TYPE_NONE*/)
 {
     if (type == TYPE_NONE)
-    {
-        // Prevent generate the same block twice in a row
-        do
-        {
-            type = BlockType(rand() % MAX_BLOCK_TYPE);
-        }
-        while (type == m_lastBlockType);
-    }
+        type = m_generator.Next();
 
-    float pos[2][2] = { { CENTER, MAX_HEIGHT}, { NEXT_BLOCK_X, NEXT_BLOCK_Y} }; 
+    int8 pos[2][2] = { { CENTER, MAX_HEIGHT}, { NEXT_BLOCK_X, NEXT_BLOCK_Y} };
 
-    Block* block = new Block(type, this, pos[!active][0], pos[!active][1]);
+    Block* block = m_blockPool.Create(type, this, pos[!active][0], pos[!active][1]);
     if (!block)
     {
         DEBUG_LOG("Failed to create block. Stopping...\n");
         exit(EXIT_FAILURE);
     }
 
-    m_lastBlockType = block->GetType();
     if (!active)
     {
         if (m_activeBlock)
@@ -99,10 +219,21 @@ Block* Game::GenerateBlock(bool active, BlockType type /*= TYPE_NONE*/)
     else
         m_activeBlock = block;
 
+    UpdateBlockHash();
+    RaiseEvent(EVENT_SPAWN);
+
+    if (m_recorder)
+        m_recorder->Record(m_tick, ReplayCode(REPLAY_SPAWN + type));
     DEBUG_LOG("Block type: %d succesfully created.\n", type);
     return block;
 }
 
+void Game::UpdateBlockHash()
+{
+    m_blockHash = GetZobristActiveKey(m_activeBlock ? m_activeBlock->GetType() : TYPE_NONE) ^
+        GetZobristNextKey(m_nextBlock ? m_nextBlock->GetType() : TYPE_NONE);
+}
+
 void Game::DestroyActiveBlock(bool withSave /*=true*/)
 {
     if (!m_activeBlock)
@@ -118,26 +249,38 @@ void Game::DestroyActiveBlock(bool withSave /*=true*/)
             sub->SetPositionX(sub->GetPositionX() + m_activeBlock->GetPositionX());
             sub->SetPositionY(sub->GetPositionY() + m_activeBlock->GetPositionY());
             m_gameBlocks.push_back(sub);
+            m_board.SetSubBlock(sub->GetPositionX(), sub->GetPositionY(), sub);
             sub->DebugPosition();
         }
 
+        // SubBlocks are owned by the board now, only the block itself goes back to the pool
+        m_activeBlock->DetachSubBlocks();
+        m_blockPool.Destroy(m_activeBlock);
+        m_piecesPlaced++;
+
         m_activeBlock = m_nextBlock;
         GenerateBlock(false);
     }
     else
+    {
+        ReleaseBlock(m_activeBlock);
+        m_activeBlock = nullptr;
         GenerateBlock(true);
+    }
 }
 
 void Game::HandleDropBlock()
 {
+    PROFILE_SCOPE("Game::HandleDropBlock");
+
     if (!m_activeBlock)
         return;
 
     if (m_activeBlock->CanDropBlock())
     {
-        float posY = std::max(m_activeBlock->GetPositionY() - 1.0f, 0.0f);
+        int8 posY = std::max(m_activeBlock->GetPositionY() - 1, 0);
         m_activeBlock->SetPositionY(posY);
-        CheckLineCompleted();
+        RaiseEvent(EVENT_DROP);
     }
     else
     {
@@ -152,17 +295,31 @@ void Game::RotateActiveBlock()
     if (!m_activeBlock)
         return;
 
+    uint8 rotation = m_activeBlock->GetRotation();
     m_activeBlock->RotateBlock();
+    if (m_activeBlock->GetRotation() != rotation)
+        RaiseEvent(EVENT_ROTATE);
 }
 
-uint64 Game::GetNextMoveTime()
+void Game::SetLevel(uint32 _level)
 {
-    return uint64(clock() + (DEFAULT_MILLISECONDS / 2.0) + double(DEFAULT_MILLISECONDS) * GetSpeed());
+    m_level = std::max<int32>(1, _level);
+    RaiseEvent(EVENT_LEVEL_CHANGED);
+
+    if (m_recorder)
+        m_recorder->Record(m_tick, REPLAY_LEVEL, m_level);
 }
 
-double Game::GetSpeed() const
+uint64 Game::GetDropInterval(uint32 level)
 {
-    return -1.0f * double(std::log(double(m_level)) / std::log(20.0)) + 2.0;
+    // The curve goes below zero past level 20^2.5, from there on the block drops every tick
+    double milliseconds = (DEFAULT_MILLISECONDS / 2.0) + double(DEFAULT_MILLISECONDS) * GetSpeed(std::max(level, 1u));
+    return std::max<uint64>(1, uint64(std::max(0.0, milliseconds)) * TICKS_PER_SECOND / 1000);
+}
+
+double Game::GetSpeed(uint32 level)
+{
+    return -1.0f * double(std::log(double(level)) / std::log(20.0)) + 2.0;
 }
 
 void Game::MoveBlock(bool right)
@@ -170,7 +327,10 @@ void Game::MoveBlock(bool right)
     if (!m_activeBlock)
         return;
 
+    int8 posX = m_activeBlock->GetPositionX();
     m_activeBlock->MoveBlock(right);
+    if (m_activeBlock->GetPositionX() != posX)
+        RaiseEvent(EVENT_MOVE);
 }
 
 void Game::DropBlock()
@@ -179,6 +339,7 @@ void Game::DropBlock()
         return;
 
     m_activeBlock->Drop();
+    RaiseEvent(EVENT_DROP);
     DestroyActiveBlock();
     CheckLineCompleted();
     CheckGameLost();
@@ -186,57 +347,33 @@ void Game::DropBlock()
 
 void Game::CheckLineCompleted()
 {
-    std::vector<float> linesCompleted;
-    for (uint32 y = 0; y < MAX_HEIGHT; y++)
-    {
-        uint8 i = 0;
-        for (uint32 x = 0; x < MAX_WIDTH; x++)
-        {
-            if (!GetSubBlockInPosition(float(x), float(y)))
-                break;
+    PROFILE_SCOPE("Game::CheckLineCompleted");
 
-            i++;
-        }
-
-        // Insert line completed if all X positions are filled with subblocks
-        if (i >= MAX_WIDTH)
-            linesCompleted.push_back(float(y));
-    }
-
-    if (linesCompleted.empty())
+    uint32 rows = m_board.GetFullRows();
+    m_lastClearedRows = rows;
+    if (!rows)
         return;
 
-    DEBUG_LOG("Lines completed: ");
-    for (float i : linesCompleted)
+    // Give back the subBlocks of the completed lines keeping the order of the rest
+    uint32 kept = 0;
+    for (SubBlock* sub : m_gameBlocks)
     {
-        for (uint32 x = 0; x < MAX_WIDTH; x++)
-        {
-            SubBlock* sub = GetSubBlockInPosition(float(x), i);
-            if (!sub)
-            {
-                DEBUG_LOG("Incorrect line completed.\n");
-                exit(EXIT_FAILURE);
-            }
-
-            sub->Delete();
-        }
-        DEBUG_LOG("[%f]", i);
+        if (rows & (1u << sub->GetPositionY()))
+            ReleaseSubBlock(sub);
+        else
+            m_gameBlocks[kept++] = sub;
     }
-    DEBUG_LOG("\n");
+    m_gameBlocks.resize(kept);
+
+    uint32 linesCompleted = m_board.ClearRows(rows);
+    DEBUG_LOG("Lines completed: %u (rows mask 0x%x)\n", linesCompleted, rows);
 
-    m_linesCompleted += linesCompleted.size();
+    uint32 level = m_level;
+    m_linesCompleted += linesCompleted;
     m_level = (m_linesCompleted / LINE_PER_DIFF) + 1;
     m_points = m_linesCompleted * 100;
 
-    std::sort(m_gameBlocks.begin(), m_gameBlocks.end());
-
-    for (SubBlock* sub : m_gameBlocks)
-    {
-        //sub->DebugPosition();
-        for (uint32 i = 0; i < linesCompleted.size(); i++)
-            if (sub->GetPositionY() >= linesCompleted[i])
-                sub->SetPositionY(sub->GetPositionY() - 1.0f);
-    }
+    RaiseEvent(m_level != level ? EVENT_LINES_CLEARED | EVENT_LEVEL_CHANGED : EVENT_LINES_CLEARED);
 }
 
 void Game::CheckGameLost()
@@ -247,36 +384,31 @@ void Game::CheckGameLost()
         exit(EXIT_FAILURE);
     }
 
-    if (GetSubBlockInPosition(CENTER, MAX_HEIGHT - 1.0f))
+    // Lost when the stack reaches the top or the new active block can't be placed
+    if (GetSubBlockInPosition(CENTER, MAX_HEIGHT - 1) ||
+        m_board.Collides(m_activeBlock->GetShape(), m_activeBlock->GetPositionX(), m_activeBlock->GetPositionY()))
         EndGame();
 }
 
 void Game::EndGame()
 {
+    m_isGameOver = true;
+    RaiseEvent(EVENT_STATE_CHANGED);
+
+    if (m_recorder)
+        m_recorder->Finish(*this);
     DEBUG_LOG("END");
 }
 
-SubBlock* Game::GetSubBlockInPosition(float x, float y)
+SubBlock* Game::GetSubBlockInPosition(int32 x, int32 y)
 {
-    SubBlock* sub = nullptr;
-
-    std::vector<SubBlock*> subBlocks = GetSubBlockList();
-    for (auto itr = subBlocks.begin(); itr != subBlocks.end(); itr++)
-    {
-        SubBlock* temp = *(itr);
-        if (temp->GetPositionX() == x && temp->GetPositionY() == y)
-        {
-            sub = temp;
-            break;
-        }
-    }
-
-    return sub;
+    return m_board.GetSubBlock(x, y);
 }
 
 void Game::ChangeBlock()
 {
     DestroyActiveBlock(false);
+    CheckGameLost();
 }
 
 void Game::DebugBlockPositions()
@@ -292,14 +424,17 @@ void Game::DebugBlockPositions()
 
 void Game::DeleteSubBlock(SubBlock* subBlock)
 {
+    m_board.RemoveSubBlock(subBlock->GetPositionX(), subBlock->GetPositionY());
     m_gameBlocks.erase(std::find(m_gameBlocks.begin(), m_gameBlocks.end(), subBlock));
+    ReleaseSubBlock(subBlock);
 }
 
 void Game::IncreaseBlockSpeed()
 {
     if (m_activeBlock && m_activeBlock->CanDropBlock())
     {
-        m_activeBlock->SetPositionY(m_activeBlock->GetPositionY() - 1.0f);
-        m_nextMoveTime = GetNextMoveTime();
+        m_activeBlock->SetPositionY(m_activeBlock->GetPositionY() - 1);
+        m_nextDropTick = m_tick + GetDropInterval();
+        RaiseEvent(EVENT_DROP);
     }
 }
@@ -3,20 +3,56 @@
 
 #include "Common.h"
 #include "Block.h"
+#include "Board.h"
+#include "PieceGenerator.h"
+#include "ObjectPool.h"
+
+class ReplayRecorder;
 
 constexpr int32 DEFAULT_LEVEL = 1;
 constexpr uint64 DEFAULT_MILLISECONDS = 500;
 
+// Logical clock of the game, one tick is one millisecond of real time
+constexpr uint32 TICKS_PER_SECOND = 1000;
+
+enum InputAction : uint8
+{
+    INPUT_NONE = 0,
+    INPUT_MOVE_LEFT,
+    INPUT_MOVE_RIGHT,
+    INPUT_ROTATE,
+    INPUT_SOFT_DROP,
+    INPUT_HARD_DROP,
+    INPUT_CHANGE_BLOCK,
+    MAX_INPUT_ACTION
+};
+
+// Changes raised by the game, accumulated until the front end consumes them
+enum GameEvent : uint32
+{
+    EVENT_NONE          = 0x00,
+    EVENT_MOVE          = 0x01,
+    EVENT_ROTATE        = 0x02,
+    EVENT_DROP          = 0x04,
+    EVENT_SPAWN         = 0x08,
+    EVENT_LINES_CLEARED = 0x10,
+    EVENT_LEVEL_CHANGED = 0x20,
+    EVENT_STATE_CHANGED = 0x40
+};
+
 class Game
 {
 public:
     Game();
     ~Game();
 
-    static Game* CreateNewGame(uint32 level = DEFAULT_LEVEL);
+    static Game* CreateNewGame(uint32 level = DEFAULT_LEVEL, uint64 seed = DEFAULT_SEED, GeneratorPolicy policy = GENERATOR_NO_REPEAT);
+
+    void ResetGame(uint32 level = DEFAULT_LEVEL, uint64 seed = DEFAULT_SEED, GeneratorPolicy policy = GENERATOR_NO_REPEAT);
 
     void StartGame();
-    void Update();
+    void Step(uint32 ticks = 1);
+    void ApplyInput(InputAction action);
     void EndGame();
     void PauseGame();
     void ResumeGame();
@@ -25,7 +61,9 @@ public:
 
     void DestroyActiveBlock(bool withSave = true);
 
-    uint64 GetNextMoveTime();
+    uint64 GetDropInterval() const { return GetDropInterval(m_level); }
+    // Gravity curve shared with the 3D mode
+    static uint64 GetDropInterval(uint32 level);
 
     void RotateActiveBlock();
 
@@ -34,22 +72,40 @@ public:
     void HandleDropBlock();
     void ChangeBlock();
     void DeleteSubBlock(SubBlock* subBlock);
+
+    SubBlock* CreateSubBlock() { return m_subBlockPool.Create(this); }
+    void ReleaseSubBlock(SubBlock* subBlock) { m_subBlockPool.Destroy(subBlock); }
+    void ReleaseBlock(Block* block);
+    void ReleaseAllBlocks();
     void IncreaseBlockSpeed();
 
+    // Locks a single cell on the board, used to build board states for fixtures
+    SubBlock* PlaceSubBlock(int32 x, int32 y, Color color);
+
     void DebugBlockPositions();
 
     void CheckLineCompleted();
     void CheckGameLost();
 
-    SubBlock* GetSubBlockInPosition(float x, float y);
+    SubBlock* GetSubBlockInPosition(int32 x, int32 y);
     
-    Block::SubBlockVector GetSubBlockList() const { return m_gameBlocks; }
+    const Block::SubBlockVector& GetSubBlockList() const { return m_gameBlocks; }
+    const Board& GetBoard() const { return m_board; }
+
+    // Zobrist hash of the locked cells and the types of the active and next blocks, equal for games in the
+    // same position whatever moves led there. The place of the active block is not part of it
+    uint64 GetHash() const { return m_board.GetHash() ^ m_blockHash; }
 
     uint32 GetPoints() const { return m_points; }
     void SetPoints(uint32 _points) { m_points = _points; }
 
     uint32 GetLevel() const { return m_level; }
-    void SetLevel(uint32 _level) { m_level = std::max<int32>(1, _level); }
+    uint32 GetLinesCompleted() const { return m_linesCompleted; }
+    uint32 GetPiecesPlaced() const { return m_piecesPlaced; }
+
+    // Rows removed by the last line check, bit y set for row y
+    uint32 GetLastClearedRows() const { return m_lastClearedRows; }
+    void SetLevel(uint32 _level);
 
     uint32 GetCurrentBlockID() { return m_currentBlockId; }
     void SetCurrentBlockID(uint32 _currentBlockId) { m_currentBlockId = _currentBlockId; }
@@ -58,32 +114,63 @@ public:
     Block* GetActiveBlock() { return m_activeBlock; }
     const Block* GetActiveBlock() const { return m_activeBlock; }
 
-    void SetActiveBlock(Block* block) { m_activeBlock = block; }
+    void SetActiveBlock(Block* block) { m_activeBlock = block; UpdateBlockHash(); }
     
     Block* GetNextBlock() { return m_nextBlock; }
     const Block* GetNextBlock() const { return m_nextBlock; }
 
-    void SetNextBlock(Block* block) { m_nextBlock = block; }
+    void SetNextBlock(Block* block) { m_nextBlock = block; UpdateBlockHash(); }
+
+    double GetSpeed() const { return GetSpeed(m_level); }
+    static double GetSpeed(uint32 level);
+
+    PieceGenerator& GetPieceGenerator() { return m_generator; }
+    const PieceGenerator& GetPieceGenerator() const { return m_generator; }
 
-    double GetSpeed() const;
+    uint64 GetTick() const { return m_tick; }
+    uint64 GetNextDropTick() const { return m_nextDropTick; }
+
+    bool IsPaused() const { return m_isPaused; }
+    bool IsGameOver() const { return m_isGameOver; }
+
+    // GameEvent flags raised since the last call
+    uint32 GetPendingEvents() const { return m_events; }
+    uint32 ConsumeEvents() { uint32 events = m_events; m_events = EVENT_NONE; return events; }
+
+    // Records inputs and spawns from the start of the game, set it before StartGame
+    void SetRecorder(ReplayRecorder* recorder);
+    ReplayRecorder* GetRecorder() const { return m_recorder; }
 
 private:
+    void RaiseEvent(uint32 events) { m_events |= events; }
+    void UpdateBlockHash();
+
+    ObjectPool<SubBlock> m_subBlockPool;
+    ObjectPool<Block> m_blockPool;
+
     Block::SubBlockVector m_gameBlocks;
+    Board m_board;
 
     Block* m_activeBlock;
     Block* m_nextBlock;
+    uint64 m_blockHash;
 
     uint32 m_points;
     uint32 m_level;
     uint32 m_linesCompleted;
+    uint32 m_lastClearedRows;
+    uint32 m_piecesPlaced;
     uint32 m_currentBlockId;
+    uint32 m_events;
 
-    uint64 m_nextMoveTime;
-    uint64 m_pausedTime;
+    uint64 m_tick;
+    uint64 m_nextDropTick;
 
-    BlockType m_lastBlockType;
+    PieceGenerator m_generator;
+    ReplayRecorder* m_recorder;
 
     bool m_isPaused;
+    bool m_isGameOver;
 };
 
 #endif
@@ -0,0 +1,239 @@
+#include "Game3D.h"
+#include "Profiler.h"
+
+Game3D::Game3D()
+{
+    m_activeType        = TYPE_NONE;
+    m_activeOrientation = 0;
+    m_points            = 0;
+    m_level             = DEFAULT_LEVEL;
+    m_layersCompleted   = 0;
+    m_piecesPlaced      = 0;
+    m_events            = EVENT_NONE;
+    m_tick              = 0;
+    m_nextDropTick      = 0;
+    m_isPaused          = false;
+    m_isGameOver        = false;
+}
+
+bool Game3D::ResetGame(int32 width /*=DEFAULT_WELL_WIDTH*/, int32 depth /*=DEFAULT_WELL_DEPTH*/, int32 height /*=DEFAULT_WELL_HEIGHT*/,
+    uint32 level /*=DEFAULT_LEVEL*/, uint64 seed /*=DEFAULT_SEED*/, GeneratorPolicy policy /*=GENERATOR_NO_REPEAT*/)
+{
+    if (!m_well.Init(width, depth, height))
+        return false;
+
+    m_activeType        = TYPE_NONE;
+    m_activeOrientation = 0;
+    m_activePosition    = Position3D();
+    m_level             = std::max(1u, level);
+    m_points            = 0;
+    m_layersCompleted   = 0;
+    m_piecesPlaced      = 0;
+    m_tick              = 0;
+    m_isPaused          = false;
+    m_isGameOver        = false;
+    m_events            = EVENT_STATE_CHANGED;
+    m_generator.Reset(seed, policy);
+    m_nextDropTick      = GetDropInterval();
+    return true;
+}
+
+void Game3D::StartGame()
+{
+    SpawnBlock();
+}
+
+void Game3D::Step(uint32 ticks /*= 1*/)
+{
+    PROFILE_SCOPE("Game3D::Step");
+
+    if (m_isPaused || m_isGameOver)
+        return;
+
+    uint64 targetTick = m_tick + ticks;
+    while (m_nextDropTick <= targetTick)
+    {
+        m_tick = m_nextDropTick;
+        m_nextDropTick = m_tick + GetDropInterval();
+        if (!DropBlock())
+            LockBlock();
+
+        if (m_isGameOver)
+            return;
+    }
+
+    m_tick = targetTick;
+}
+
+void Game3D::ApplyInput(Input3DAction action)
+{
+    if (m_isPaused || m_isGameOver || !HasActiveBlock())
+        return;
+
+    switch (action)
+    {
+    case INPUT_3D_MOVE_LEFT:
+        MoveBlock(-1, 0);
+        break;
+    case INPUT_3D_MOVE_RIGHT:
+        MoveBlock(1, 0);
+        break;
+    case INPUT_3D_MOVE_FORWARD:
+        MoveBlock(0, 1);
+        break;
+    case INPUT_3D_MOVE_BACK:
+        MoveBlock(0, -1);
+        break;
+    case INPUT_3D_ROTATE_X:
+        RotateBlock(AXIS_X);
+        break;
+    case INPUT_3D_ROTATE_Y:
+        RotateBlock(AXIS_Y);
+        break;
+    case INPUT_3D_ROTATE_Z:
+        RotateBlock(AXIS_Z);
+        break;
+    case INPUT_3D_SOFT_DROP:
+        // Like the 2D game, a soft drop restarts the gravity timer
+        if (DropBlock())
+            m_nextDropTick = m_tick + GetDropInterval();
+        break;
+    case INPUT_3D_HARD_DROP:
+        HardDropBlock();
+        break;
+    default:
+        break;
+    }
+}
+
+void Game3D::EndGame()
+{
+    m_isGameOver = true;
+    RaiseEvent(EVENT_STATE_CHANGED);
+}
+
+void Game3D::PauseGame()
+{
+    m_isPaused = true;
+    RaiseEvent(EVENT_STATE_CHANGED);
+}
+
+void Game3D::ResumeGame()
+{
+    m_isPaused = false;
+    m_nextDropTick = m_tick + GetDropInterval();
+    RaiseEvent(EVENT_STATE_CHANGED);
+}
+
+bool Game3D::Fits(uint8 orientation, Position3D position) const
+{
+    return !m_well.Collides(m_activeType, orientation, position.x, position.y, position.z);
+}
+
+bool Game3D::MoveBlock(int32 dx, int32 dz)
+{
+    Position3D position(int8(m_activePosition.x + dx), m_activePosition.y, int8(m_activePosition.z + dz));
+    if (!HasActiveBlock() || !Fits(m_activeOrientation, position))
+        return false;
+
+    m_activePosition = position;
+    RaiseEvent(EVENT_MOVE);
+    return true;
+}
+
+bool Game3D::RotateBlock(RotationAxis axis)
+{
+    if (!HasActiveBlock())
+        return false;
+
+    // Turned in place if it fits, otherwise nudged one cell away from a wall or the stack
+    static const int8 kicks[][3] = { { 0, 0, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 } };
+
+    uint8 orientation = RotateOrientation(m_activeOrientation, axis);
+    for (const int8* kick : kicks)
+    {
+        Position3D position(int8(m_activePosition.x + kick[0]), int8(m_activePosition.y + kick[1]), int8(m_activePosition.z + kick[2]));
+        if (Fits(orientation, position))
+        {
+            m_activeOrientation = orientation;
+            m_activePosition = position;
+            RaiseEvent(EVENT_ROTATE);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Game3D::DropBlock()
+{
+    Position3D position(m_activePosition.x, int8(m_activePosition.y - 1), m_activePosition.z);
+    if (!HasActiveBlock() || !Fits(m_activeOrientation, position))
+        return false;
+
+    m_activePosition = position;
+    RaiseEvent(EVENT_DROP);
+    return true;
+}
+
+void Game3D::HardDropBlock()
+{
+    if (!HasActiveBlock())
+        return;
+
+    m_activePosition.y = int8(GetLandingY());
+    RaiseEvent(EVENT_DROP);
+    LockBlock();
+}
+
+int32 Game3D::GetLandingY() const
+{
+    if (!HasActiveBlock())
+        return m_activePosition.y;
+
+    return m_activePosition.y - m_well.GetDropDistance(m_activeType, m_activeOrientation, m_activePosition.x, m_activePosition.y, m_activePosition.z);
+}
+
+void Game3D::SpawnBlock()
+{
+    // Flat, centered over the well and resting on the first hidden layer
+    m_activeType = m_generator.Next();
+    m_activeOrientation = 0;
+
+    const WellShape& shape = m_well.GetShape(m_activeType, m_activeOrientation);
+    int32 x = (m_well.GetWidth() - (shape.maxX - shape.minX + 1)) / 2 - shape.minX;
+    int32 z = (m_well.GetDepth() - (shape.maxZ - shape.minZ + 1)) / 2 - shape.minZ;
+    m_activePosition = Position3D(int8(x), int8(m_well.GetHeight() - shape.minY), int8(z));
+
+    RaiseEvent(EVENT_SPAWN);
+    if (!Fits(m_activeOrientation, m_activePosition))
+        EndGame();
+}
+
+void Game3D::LockBlock()
+{
+    PROFILE_SCOPE("Game3D::LockBlock");
+
+    m_well.Lock(m_activeType, m_activeOrientation, m_activePosition.x, m_activePosition.y, m_activePosition.z, Block::GetColorByType(m_activeType));
+    m_activeType = TYPE_NONE;
+    m_piecesPlaced++;
+
+    uint32 layers = m_well.GetFullLayers();
+    if (layers)
+    {
+        uint32 level = m_level;
+        m_layersCompleted += m_well.ClearLayers(layers);
+        m_level = std::max(m_level, (m_layersCompleted / LINE_PER_DIFF) + 1);
+        m_points = m_layersCompleted * 100;
+        RaiseEvent(m_level != level ? EVENT_LINES_CLEARED | EVENT_LEVEL_CHANGED : EVENT_LINES_CLEARED);
+    }
+
+    // Lost when the stack reaches the hidden layers or the new block can't be placed
+    if (m_well.GetStackHeight() > m_well.GetHeight())
+    {
+        EndGame();
+        return;
+    }
+
+    SpawnBlock();
+}
@@ -0,0 +1,101 @@
+#ifndef GAME_3D_H
+#define GAME_3D_H
+
+#include "Common.h"
+#include "Game.h"
+#include "Well3D.h"
+
+enum Input3DAction : uint8
+{
+    INPUT_3D_NONE = 0,
+    INPUT_3D_MOVE_LEFT,
+    INPUT_3D_MOVE_RIGHT,
+    INPUT_3D_MOVE_FORWARD,      // Towards the back of the well, +z
+    INPUT_3D_MOVE_BACK,         // Towards the front, -z
+    INPUT_3D_ROTATE_X,
+    INPUT_3D_ROTATE_Y,
+    INPUT_3D_ROTATE_Z,
+    INPUT_3D_SOFT_DROP,
+    INPUT_3D_HARD_DROP,
+    MAX_INPUT_3D_ACTION
+};
+
+// Falling blocks in a width x depth x height well. The active block is just a type, an orientation and
+// a position checked against the layer masks, so a tick costs the same whatever the size of the well.
+// Uses the tick clock, gravity curve, scoring and GameEvent flags of the 2D game.
+class Game3D
+{
+public:
+    Game3D();
+
+    bool ResetGame(int32 width = DEFAULT_WELL_WIDTH, int32 depth = DEFAULT_WELL_DEPTH, int32 height = DEFAULT_WELL_HEIGHT,
+        uint32 level = DEFAULT_LEVEL, uint64 seed = DEFAULT_SEED, GeneratorPolicy policy = GENERATOR_NO_REPEAT);
+
+    void StartGame();
+    void Step(uint32 ticks = 1);
+    void ApplyInput(Input3DAction action);
+    void EndGame();
+    void PauseGame();
+    void ResumeGame();
+
+    bool MoveBlock(int32 dx, int32 dz);
+    bool RotateBlock(RotationAxis axis);
+    bool DropBlock();
+    void HardDropBlock();
+
+    const Well3D& GetWell() const { return m_well; }
+
+    bool HasActiveBlock() const { return m_activeType != TYPE_NONE; }
+    BlockType GetActiveType() const { return m_activeType; }
+    uint8 GetActiveOrientation() const { return m_activeOrientation; }
+    Position3D GetActivePosition() const { return m_activePosition; }
+    BlockType GetNextType() const { return m_generator.Peek(0); }
+
+    // Layer the active block origin would rest on after a hard drop
+    int32 GetLandingY() const;
+
+    uint32 GetPoints() const { return m_points; }
+    uint32 GetLevel() const { return m_level; }
+    uint32 GetLayersCompleted() const { return m_layersCompleted; }
+    uint32 GetPiecesPlaced() const { return m_piecesPlaced; }
+
+    uint64 GetDropInterval() const { return Game::GetDropInterval(m_level); }
+    double GetSpeed() const { return Game::GetSpeed(m_level); }
+
+    uint64 GetTick() const { return m_tick; }
+    uint64 GetNextDropTick() const { return m_nextDropTick; }
+
+    bool IsPaused() const { return m_isPaused; }
+    bool IsGameOver() const { return m_isGameOver; }
+
+    // GameEvent flags raised since the last call
+    uint32 GetPendingEvents() const { return m_events; }
+    uint32 ConsumeEvents() { uint32 events = m_events; m_events = EVENT_NONE; return events; }
+
+private:
+    void RaiseEvent(uint32 events) { m_events |= events; }
+    bool Fits(uint8 orientation, Position3D position) const;
+    void SpawnBlock();
+    void LockBlock();
+
+    Well3D m_well;
+    PieceGenerator m_generator;
+
+    BlockType m_activeType;
+    uint8 m_activeOrientation;
+    Position3D m_activePosition;
+
+    uint32 m_points;
+    uint32 m_level;
+    uint32 m_layersCompleted;
+    uint32 m_piecesPlaced;
+    uint32 m_events;
+
+    uint64 m_tick;
+    uint64 m_nextDropTick;
+
+    bool m_isPaused;
+    bool m_isGameOver;
+};
+
+#endif
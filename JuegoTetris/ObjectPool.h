@@ -0,0 +1,69 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include "Common.h"
+#include <memory>
+#include <new>
+#include <utility>
+
+// Free-list pool that hands out storage for T from chunks that are kept until the pool is destroyed.
+// Every object created must be destroyed through the pool before it goes away.
+template <typename T, uint32 ChunkSize = 64>
+class ObjectPool
+{
+public:
+    ObjectPool() : m_freeList(nullptr), m_liveCount(0) { }
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    template <typename... Args>
+    T* Create(Args&&... args)
+    {
+        if (!m_freeList)
+            AllocateChunk();
+
+        Slot* slot = m_freeList;
+        m_freeList = slot->next;
+        m_liveCount++;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void Destroy(T* object)
+    {
+        if (!object)
+            return;
+
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = m_freeList;
+        m_freeList = slot;
+        m_liveCount--;
+    }
+
+    uint32 GetLiveCount() const { return m_liveCount; }
+    uint32 GetCapacity() const { return uint32(m_chunks.size()) * ChunkSize; }
+
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void AllocateChunk()
+    {
+        Slot* chunk = new Slot[ChunkSize];
+        m_chunks.emplace_back(chunk);
+        for (uint32 i = 0; i < ChunkSize; i++)
+        {
+            chunk[i].next = m_freeList;
+            m_freeList = &chunk[i];
+        }
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> m_chunks;
+    Slot* m_freeList;
+    uint32 m_liveCount;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "PieceGenerator.h"
+
+PieceGenerator::PieceGenerator(uint64 seed /*= DEFAULT_SEED*/, GeneratorPolicy policy /*= GENERATOR_NO_REPEAT*/)
+{
+    Reset(seed, policy);
+}
+
+void PieceGenerator::Reset(uint64 seed, GeneratorPolicy policy)
+{
+    m_seed          = seed;
+    m_random.Seed(seed);
+    m_policy        = policy;
+    m_lastType      = TYPE_NONE;
+    m_bagIndex      = NUM_PIECE_TYPES;
+    m_sequenceIndex = 0;
+    FillQueue();
+}
+
+void PieceGenerator::SetSequence(const std::vector<BlockType>& sequence)
+{
+    m_sequence = sequence;
+    m_sequenceIndex = 0;
+    FillQueue();
+}
+
+void PieceGenerator::FillQueue()
+{
+    m_queueHead = 0;
+    for (uint32 i = 0; i < PIECE_PREVIEW_SIZE; i++)
+        m_queue[i] = Generate();
+}
+
+BlockType PieceGenerator::Next()
+{
+    BlockType type = m_queue[m_queueHead];
+    m_queue[m_queueHead] = Generate();
+    m_queueHead = (m_queueHead + 1) & (PIECE_PREVIEW_SIZE - 1);
+    return type;
+}
+
+BlockType PieceGenerator::Generate()
+{
+    BlockType type = TYPE_NONE;
+    switch (m_policy)
+    {
+    case GENERATOR_BAG:
+        if (m_bagIndex >= NUM_PIECE_TYPES)
+        {
+            for (uint8 i = 0; i < NUM_PIECE_TYPES; i++)
+                m_bag[i] = BlockType(TYPE_NONE + 1 + i);
+
+            for (uint8 i = NUM_PIECE_TYPES - 1; i > 0; i--)
+                std::swap(m_bag[i], m_bag[m_random.Next(i + 1)]);
+
+            m_bagIndex = 0;
+        }
+        type = m_bag[m_bagIndex++];
+        break;
+    case GENERATOR_SEQUENCE:
+        if (!m_sequence.empty())
+        {
+            type = m_sequence[m_sequenceIndex];
+            m_sequenceIndex = (m_sequenceIndex + 1) % m_sequence.size();
+            break;
+        }
+        // Without a sequence behave as the default policy
+        [[fallthrough]];
+    case GENERATOR_NO_REPEAT:
+    default:
+        // Prevent generate the same block twice in a row, drawing from the other types only
+        if (m_lastType == TYPE_NONE)
+            type = BlockType(TYPE_NONE + 1 + m_random.Next(NUM_PIECE_TYPES));
+        else
+        {
+            type = BlockType(TYPE_NONE + 1 + m_random.Next(NUM_PIECE_TYPES - 1));
+            if (type >= m_lastType)
+                type = BlockType(type + 1);
+        }
+        break;
+    }
+
+    m_lastType = type;
+    return type;
+}
@@ -0,0 +1,57 @@
+#ifndef PIECE_GENERATOR_H
+#define PIECE_GENERATOR_H
+
+#include "Common.h"
+#include "Block.h"
+#include "Random.h"
+
+// Upcoming pieces kept ready by the generator, must be a power of two
+#define PIECE_PREVIEW_SIZE          8
+#define NUM_PIECE_TYPES             (MAX_BLOCK_TYPE - 1)
+
+constexpr uint64 DEFAULT_SEED = 0x5EED;
+
+enum GeneratorPolicy : uint8
+{
+    GENERATOR_NO_REPEAT = 0,    // Uniform random, never the same type twice in a row
+    GENERATOR_BAG,              // Every type once per bag of 7, in random order
+    GENERATOR_SEQUENCE,         // Fixed sequence, repeated when exhausted
+    MAX_GENERATOR_POLICY
+};
+
+// Seeded random piece source owned by each game, so games don't share any random state
+class PieceGenerator
+{
+public:
+    PieceGenerator(uint64 seed = DEFAULT_SEED, GeneratorPolicy policy = GENERATOR_NO_REPEAT);
+
+    void Reset(uint64 seed, GeneratorPolicy policy);
+    void SetSequence(const std::vector<BlockType>& sequence);
+
+    BlockType Next();
+    BlockType Peek(uint32 index) const { return m_queue[(m_queueHead + index) & (PIECE_PREVIEW_SIZE - 1)]; }
+
+    uint64 GetSeed() const { return m_seed; }
+    GeneratorPolicy GetPolicy() const { return m_policy; }
+
+private:
+    BlockType Generate();
+    void FillQueue();
+
+    uint64 m_seed;
+    Random m_random;
+    GeneratorPolicy m_policy;
+
+    BlockType m_lastType;
+
+    BlockType m_bag[NUM_PIECE_TYPES];
+    uint8 m_bagIndex;
+
+    std::vector<BlockType> m_sequence;
+    uint32 m_sequenceIndex;
+
+    BlockType m_queue[PIECE_PREVIEW_SIZE];
+    uint32 m_queueHead;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "Profiler.h"
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+std::atomic<bool> Profiler::s_enabled(false);
+std::atomic<uint64> Profiler::s_clearTime(0);
+
+// Written only by its thread. Slots are relaxed atomics so readers on other threads never race,
+// a reader may still get a sample that is being overwritten, which is fine for diagnostics
+struct ProfileRing
+{
+    std::atomic<const char*> names[PROFILE_RING_SIZE];
+    std::atomic<uint64> starts[PROFILE_RING_SIZE];
+    std::atomic<uint64> durations[PROFILE_RING_SIZE];
+    std::atomic<uint32> head;
+    uint32 threadId;
+};
+
+struct ProfileRegistry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+};
+
+ProfileRegistry& GetRegistry()
+{
+    static ProfileRegistry registry;
+    return registry;
+}
+
+ProfileRing* GetThreadRing()
+{
+    thread_local ProfileRing* ring = nullptr;
+    if (!ring)
+    {
+        ProfileRegistry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        // Rings outlive their threads so samples of finished workers can still be exported
+        registry.rings.emplace_back(new ProfileRing());
+        ring = registry.rings.back().get();
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->threadId = uint32(registry.rings.size());
+    }
+
+    return ring;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64 Profiler::Now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void Profiler::Record(const char* name, uint64 start, uint64 end)
+{
+    ProfileRing* ring = GetThreadRing();
+    uint32 head = ring->head.load(std::memory_order_relaxed);
+    uint32 slot = head % PROFILE_RING_SIZE;
+
+    ring->names[slot].store(name, std::memory_order_relaxed);
+    ring->starts[slot].store(start, std::memory_order_relaxed);
+    ring->durations[slot].store(end - start, std::memory_order_relaxed);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Clear()
+{
+    s_clearTime.store(Now(), std::memory_order_relaxed);
+}
+
+void Profiler::CollectSamples(std::vector<ProfileSample>& samples)
+{
+    uint64 clearTime = s_clearTime.load(std::memory_order_relaxed);
+    ProfileRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (const std::unique_ptr<ProfileRing>& ring : registry.rings)
+    {
+        uint32 head = ring->head.load(std::memory_order_acquire);
+        uint32 count = std::min<uint32>(head, PROFILE_RING_SIZE);
+        for (uint32 i = head - count; i != head; i++)
+        {
+            uint32 slot = i % PROFILE_RING_SIZE;
+            ProfileSample sample;
+            sample.name = ring->names[slot].load(std::memory_order_relaxed);
+            sample.start = ring->starts[slot].load(std::memory_order_relaxed);
+            sample.duration = ring->durations[slot].load(std::memory_order_relaxed);
+            sample.threadId = ring->threadId;
+
+            if (sample.start >= clearTime)
+                samples.push_back(sample);
+        }
+    }
+}
+
+void Profiler::Summarize(std::vector<ProfileStat>& stats, uint64 window)
+{
+    std::vector<ProfileSample> samples;
+    CollectSamples(samples);
+
+    uint64 now = Now();
+    uint64 from = now > window ? now - window : 0;
+
+    stats.clear();
+    for (const ProfileSample& sample : samples)
+    {
+        if (sample.start + sample.duration < from)
+            continue;
+
+        // Few distinct names, a linear search is enough. The same literal can have a different address per file
+        ProfileStat* stat = nullptr;
+        for (ProfileStat& candidate : stats)
+            if (candidate.name == sample.name || !strcmp(candidate.name, sample.name))
+                stat = &candidate;
+
+        if (!stat)
+        {
+            stats.push_back(ProfileStat{ sample.name, 0, 0, 0, 0 });
+            stat = &stats.back();
+        }
+
+        stat->count++;
+        stat->total += sample.duration;
+        stat->max = std::max(stat->max, sample.duration);
+        stat->last = sample.duration;
+    }
+}
+
+bool Profiler::ExportChromeTrace(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        DEBUG_LOG("Failed to open trace file %s\n", filename);
+        return false;
+    }
+
+    std::vector<ProfileSample> samples;
+    CollectSamples(samples);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const ProfileSample& sample = samples[i];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            sample.name, sample.threadId, double(sample.start) / 1000.0, double(sample.duration) / 1000.0,
+            i + 1 < samples.size() ? "," : "");
+    }
+    fprintf(file, "]}\n");
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,85 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Common.h"
+#include <atomic>
+
+// Samples kept per thread, older ones are overwritten
+#define PROFILE_RING_SIZE   4096
+
+struct ProfileSample
+{
+    const char* name;
+    uint64 start;       // Nanoseconds since the profiler started
+    uint64 duration;
+    uint32 threadId;
+};
+
+struct ProfileStat
+{
+    const char* name;
+    uint32 count;
+    uint64 total;
+    uint64 max;
+    uint64 last;
+};
+
+// Scoped timers written to per-thread ring buffers. Disabled it costs one relaxed load per scope,
+// so it stays compiled in release builds and is switched on at runtime
+class Profiler
+{
+public:
+    static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void SetEnabled(bool enabled);
+
+    static uint64 Now();
+    static void Record(const char* name, uint64 start, uint64 end);
+
+    // Drops everything recorded so far
+    static void Clear();
+
+    static void CollectSamples(std::vector<ProfileSample>& samples);
+
+    // Per name statistics of the samples that ended in the last window nanoseconds
+    static void Summarize(std::vector<ProfileStat>& stats, uint64 window);
+
+    // Chrome trace event format, loads in chrome://tracing and Perfetto
+    static bool ExportChromeTrace(const char* filename);
+
+private:
+    static std::atomic<bool> s_enabled;
+    static std::atomic<uint64> s_clearTime;
+};
+
+class ProfileScope
+{
+public:
+    // name has to outlive the profiler, string literals only
+    ProfileScope(const char* name) : m_name(name), m_isActive(Profiler::IsEnabled())
+    {
+        if (m_isActive)
+            m_start = Profiler::Now();
+    }
+
+    ~ProfileScope()
+    {
+        if (m_isActive)
+            Profiler::Record(m_name, m_start, Profiler::Now());
+    }
+
+private:
+    const char* m_name;
+    uint64 m_start;
+    bool m_isActive;
+};
+
+#define PROFILE_CONCAT_INNER(a, b)  a##b
+#define PROFILE_CONCAT(a, b)        PROFILE_CONCAT_INNER(a, b)
+
+#ifndef TETRIS_NO_PROFILER
+    #define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+    #define PROFILE_SCOPE(name)
+#endif
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "Common.h"
+
+// Small seedable generator (SplitMix64), cheap to copy and keep one per game or thread. Usable at compile time
+class Random
+{
+public:
+    constexpr Random(uint64 seed = 0) : m_state(seed) { }
+
+    constexpr void Seed(uint64 seed) { m_state = seed; }
+
+    constexpr uint64 Next64()
+    {
+        m_state += 0x9E3779B97F4A7C15ULL;
+        uint64 z = m_state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, bound), scaled with a multiply instead of a modulo
+    uint32 Next(uint32 bound) { return uint32(((Next64() >> 32) * uint64(bound)) >> 32); }
+
+    // Uniform in [0, 1)
+    double NextDouble() { return double(Next64() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64 m_state;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "RealTimeDriver.h"
+#include "Game.h"
+#include "Replay.h"
+
+RealTimeDriver::RealTimeDriver(Game* game)
+{
+    m_game                  = game;
+    m_replay                = nullptr;
+    m_lastUpdate            = Clock::now();
+    m_pendingMicroseconds   = 0;
+    m_speed                 = 1;
+    m_isPaused              = false;
+}
+
+void RealTimeDriver::SetGame(Game* game)
+{
+    m_game = game;
+    m_lastUpdate = Clock::now();
+    m_pendingMicroseconds = 0;
+}
+
+void RealTimeDriver::Update()
+{
+    Clock::time_point now = Clock::now();
+    if (m_isPaused || !m_game)
+    {
+        m_lastUpdate = now;
+        return;
+    }
+
+    // Keep the remainder so no time is lost between updates
+    m_pendingMicroseconds += uint64(std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastUpdate).count()) * m_speed;
+    m_lastUpdate = now;
+
+    uint64 ticks = m_pendingMicroseconds * TICKS_PER_SECOND / 1000000;
+    if (!ticks)
+        return;
+
+    m_pendingMicroseconds -= ticks * 1000000 / TICKS_PER_SECOND;
+    if (m_replay)
+        m_replay->Advance(m_game->GetTick() + ticks);
+    else
+        m_game->Step(uint32(ticks));
+}
+
+void RealTimeDriver::Pause()
+{
+    m_isPaused = true;
+    if (m_game && !m_replay)
+        m_game->PauseGame();
+}
+
+void RealTimeDriver::Resume()
+{
+    m_isPaused = false;
+    m_lastUpdate = Clock::now();
+    m_pendingMicroseconds = 0;
+    if (m_game && !m_replay)
+        m_game->ResumeGame();
+}
+
+uint64 RealTimeDriver::GetMicrosecondsToNextDrop() const
+{
+    if (!m_game)
+        return 0;
+
+    // A replay also has inputs to apply before the drop
+    uint64 nextTick = m_game->GetNextDropTick();
+    if (m_replay && !m_replay->IsFinished())
+        nextTick = std::min(nextTick, m_replay->GetNextTick());
+
+    if (nextTick <= m_game->GetTick())
+        return 0;
+
+    uint64 microseconds = (nextTick - m_game->GetTick()) * 1000000 / TICKS_PER_SECOND;
+    return microseconds > m_pendingMicroseconds ? (microseconds - m_pendingMicroseconds) / m_speed : 0;
+}
@@ -0,0 +1,49 @@
+#ifndef REAL_TIME_DRIVER_H
+#define REAL_TIME_DRIVER_H
+
+#include "Common.h"
+#include <chrono>
+
+class Game;
+class ReplayPlayer;
+
+// Paces a Game against the wall clock, stepping it by the ticks elapsed since the last update
+class RealTimeDriver
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    RealTimeDriver(Game* game);
+
+    void Update();
+    void Pause();
+    void Resume();
+
+    bool IsPaused() const { return m_isPaused; }
+
+    // Wall time left until the game has something to do on its own, zero when it is due
+    uint64 GetMicrosecondsToNextDrop() const;
+
+    Game* GetGame() const { return m_game; }
+    void SetGame(Game* game);
+
+    // Plays a started replay instead of stepping the game, pausing then only stops the clock
+    void SetReplay(ReplayPlayer* replay) { m_replay = replay; }
+    ReplayPlayer* GetReplay() const { return m_replay; }
+
+    // Game ticks per real tick, to fast forward replays
+    void SetSpeed(uint32 speed) { m_speed = std::max(1u, speed); }
+    uint32 GetSpeed() const { return m_speed; }
+
+private:
+    Game* m_game;
+    ReplayPlayer* m_replay;
+
+    Clock::time_point m_lastUpdate;
+    uint64 m_pendingMicroseconds;
+    uint32 m_speed;
+
+    bool m_isPaused;
+};
+
+#endif
@@ -0,0 +1,311 @@
+#include "Replay.h"
+#include "Game.h"
+#include <cstring>
+
+// Magic, version, policy and seed, the level varint follows
+#define REPLAY_FIXED_HEADER_SIZE    14
+
+ReplayRecorder::ReplayRecorder()
+{
+    m_lastTick      = 0;
+    m_isFinished    = false;
+}
+
+void ReplayRecorder::Begin(uint32 level, uint64 seed, GeneratorPolicy policy)
+{
+    m_data.clear();
+    for (const char* magic = REPLAY_MAGIC; *magic; magic++)
+        m_data.push_back(uint8(*magic));
+    m_data.push_back(REPLAY_VERSION);
+    m_data.push_back(policy);
+    for (uint32 i = 0; i < 8; i++)
+        m_data.push_back(uint8(seed >> (i * BYTE_SIZE)));
+    PutVarint(level);
+
+    m_lastTick = 0;
+    m_isFinished = false;
+}
+
+void ReplayRecorder::Record(uint64 tick, ReplayCode code, uint32 argument /*= 0*/)
+{
+    if (m_isFinished || m_data.empty())
+        return;
+
+    // Inputs come in bursts, most records fit in one or two bytes
+    PutVarint(((tick - m_lastTick) << REPLAY_CODE_BITS) | code);
+    m_lastTick = tick;
+
+    if (code == REPLAY_LEVEL)
+        PutVarint(argument);
+}
+
+void ReplayRecorder::Finish(const Game& game)
+{
+    if (m_isFinished || m_data.empty())
+        return;
+
+    Record(game.GetTick(), REPLAY_END);
+    PutVarint(game.GetPoints());
+    PutVarint(game.GetLinesCompleted());
+    PutVarint(game.GetPiecesPlaced());
+    m_isFinished = true;
+}
+
+bool ReplayRecorder::Save(const char* filename) const
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open file: %s\n", filename);
+        return false;
+    }
+
+    bool written = fwrite(m_data.data(), 1, m_data.size(), file) == m_data.size();
+    return fclose(file) == 0 && written;
+}
+
+void ReplayRecorder::PutVarint(uint64 value)
+{
+    // LEB128, seven bits per byte with the high bit set when more bytes follow
+    while (value >= 0x80)
+    {
+        m_data.push_back(uint8(value | 0x80));
+        value >>= 7;
+    }
+    m_data.push_back(uint8(value));
+}
+
+ReplayPlayer::ReplayPlayer()
+{
+    m_bodyStart     = 0;
+    m_position      = 0;
+    m_verifiedSize  = 0;
+    m_game          = nullptr;
+    m_seed          = DEFAULT_SEED;
+    m_level         = DEFAULT_LEVEL;
+    m_policy        = GENERATOR_NO_REPEAT;
+    m_tick          = 0;
+    m_nextTick      = 0;
+    m_endTick       = 0;
+    m_desyncTick    = 0;
+    m_recordCount   = 0;
+    m_isDesynced    = false;
+}
+
+bool ReplayPlayer::Load(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open file: %s\n", filename);
+        return false;
+    }
+
+    std::vector<uint8> data;
+    uint8 buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+    fclose(file);
+
+    return Open(std::move(data));
+}
+
+bool ReplayPlayer::Open(std::vector<uint8> data)
+{
+    m_data.clear();
+    m_position = 0;
+    m_recordCount = 0;
+
+    if (data.size() < REPLAY_FIXED_HEADER_SIZE || memcmp(data.data(), REPLAY_MAGIC, 4) || data[4] != REPLAY_VERSION || data[5] >= MAX_GENERATOR_POLICY)
+        return false;
+
+    m_data.swap(data);
+    m_policy = GeneratorPolicy(m_data[5]);
+    m_seed = 0;
+    for (uint32 i = 0; i < 8; i++)
+        m_seed |= uint64(m_data[6 + i]) << (i * BYTE_SIZE);
+
+    size_t position = REPLAY_FIXED_HEADER_SIZE;
+    uint64 level;
+    if (!ReadVarint(position, level) || level > UINT32_MAX)
+    {
+        m_data.clear();
+        return false;
+    }
+    m_level = uint32(level);
+    m_bodyStart = position;
+
+    // Validate everything up front, playback then never meets a broken record halfway
+    uint64 tick = 0;
+    uint8 code;
+    uint32 argument;
+    while (position < m_data.size())
+    {
+        if (!ReadRecord(position, tick, code, argument) || (code == REPLAY_END && position != m_data.size()))
+        {
+            m_data.clear();
+            return false;
+        }
+        m_recordCount++;
+    }
+
+    m_endTick = tick;
+    m_position = m_data.size();
+    return true;
+}
+
+bool ReplayPlayer::Start(Game* game)
+{
+    if (m_data.empty() || !game)
+        return false;
+
+    m_game = game;
+    m_position = m_bodyStart;
+    m_verifiedSize = 0;
+    m_tick = 0;
+    m_desyncTick = 0;
+    m_isDesynced = false;
+
+    game->SetRecorder(&m_verifier);
+    game->ResetGame(m_level, m_seed, m_policy);
+    game->StartGame();
+
+    PeekNextTick();
+    return CheckVerifier();
+}
+
+bool ReplayPlayer::Advance(uint64 tick)
+{
+    if (!m_game || m_isDesynced)
+        return false;
+
+    while (!IsFinished() && m_nextTick <= tick)
+    {
+        uint64 recordTick = m_tick;
+        uint8 code = REPLAY_END;
+        uint32 argument = 0;
+        if (!ReadRecord(m_position, recordTick, code, argument))
+        {
+            m_isDesynced = true;
+            m_desyncTick = m_game->GetTick();
+            return false;
+        }
+        m_tick = recordTick;
+
+        if (recordTick > m_game->GetTick())
+            m_game->Step(uint32(recordTick - m_game->GetTick()));
+
+        // A paused or finished game stops its clock, the recording must agree
+        if (m_game->GetTick() != recordTick)
+        {
+            m_isDesynced = true;
+            m_desyncTick = m_game->GetTick();
+            return false;
+        }
+
+        if (code < MAX_INPUT_ACTION)
+            m_game->ApplyInput(InputAction(code));
+        else if (code == REPLAY_PAUSE)
+            m_game->PauseGame();
+        else if (code == REPLAY_RESUME)
+            m_game->ResumeGame();
+        else if (code == REPLAY_LEVEL)
+            m_game->SetLevel(argument);
+        else if (code == REPLAY_END)
+            m_verifier.Finish(*m_game);
+        // Spawns are not applied, the game spawns on its own and the verifier compares them
+
+        PeekNextTick();
+        if (!CheckVerifier())
+            return false;
+    }
+
+    // Between records only gravity acts, nothing to step once the recording is over
+    if (!IsFinished() && tick > m_game->GetTick())
+    {
+        m_game->Step(uint32(tick - m_game->GetTick()));
+        return CheckVerifier();
+    }
+
+    return true;
+}
+
+bool ReplayPlayer::Run(Game* game)
+{
+    return Start(game) && Advance(UINT64_MAX) && IsVerified();
+}
+
+bool ReplayPlayer::ReadVarint(size_t& position, uint64& value) const
+{
+    value = 0;
+    for (uint32 shift = 0; shift < 64 && position < m_data.size(); shift += 7)
+    {
+        uint8 byte = m_data[position++];
+        value |= uint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+bool ReplayPlayer::ReadRecord(size_t& position, uint64& tick, uint8& code, uint32& argument) const
+{
+    uint64 packed;
+    if (!ReadVarint(position, packed))
+        return false;
+
+    tick += packed >> REPLAY_CODE_BITS;
+    code = uint8(packed & (MAX_REPLAY_CODE - 1));
+    argument = 0;
+
+    if (code > INPUT_NONE && code < MAX_INPUT_ACTION)
+        return true;
+
+    uint64 value;
+    switch (code)
+    {
+    case REPLAY_PAUSE:
+    case REPLAY_RESUME:
+        return true;
+    case REPLAY_LEVEL:
+        if (!ReadVarint(position, value) || value > UINT32_MAX)
+            return false;
+        argument = uint32(value);
+        return true;
+    case REPLAY_END:
+        // Points, lines and pieces, only compared through the verifier
+        return ReadVarint(position, value) && ReadVarint(position, value) && ReadVarint(position, value);
+    default:
+        return code > REPLAY_SPAWN && code < REPLAY_SPAWN + MAX_BLOCK_TYPE;
+    }
+}
+
+void ReplayPlayer::PeekNextTick()
+{
+    m_nextTick = m_tick;
+    if (IsFinished())
+        return;
+
+    size_t position = m_position;
+    uint64 packed;
+    if (ReadVarint(position, packed))
+        m_nextTick = m_tick + (packed >> REPLAY_CODE_BITS);
+}
+
+bool ReplayPlayer::CheckVerifier()
+{
+    // Only the bytes recorded since the last check are compared
+    const std::vector<uint8>& replayed = m_verifier.GetData();
+    if (replayed.size() > m_data.size() ||
+        memcmp(replayed.data() + m_verifiedSize, m_data.data() + m_verifiedSize, replayed.size() - m_verifiedSize))
+    {
+        m_isDesynced = true;
+        m_desyncTick = m_game->GetTick();
+        return false;
+    }
+
+    m_verifiedSize = replayed.size();
+    return true;
+}
@@ -0,0 +1,111 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "Common.h"
+#include "Block.h"
+#include "PieceGenerator.h"
+
+class Game;
+
+#define REPLAY_MAGIC            "T3DR"
+#define REPLAY_VERSION          1
+#define REPLAY_CODE_BITS        5
+
+// Code of a record, packed with the ticks since the previous record in one varint:
+// (deltaTicks << REPLAY_CODE_BITS) | code. Codes 1 to MAX_INPUT_ACTION - 1 are the InputAction applied
+enum ReplayCode : uint8
+{
+    REPLAY_PAUSE        = 7,
+    REPLAY_RESUME       = 8,
+    REPLAY_LEVEL        = 9,    // Followed by the level set
+    REPLAY_END          = 10,   // Followed by points, lines and pieces placed, checked on playback
+    REPLAY_SPAWN        = 16,   // Plus the BlockType, checked on playback
+    MAX_REPLAY_CODE     = 1 << REPLAY_CODE_BITS
+};
+
+// Header: magic, version, generator policy, seed (8 bytes little endian) and starting level as a varint.
+// The game is deterministic from there, so the inputs are enough to rebuild it and the spawns and the
+// final score let the player check that it did
+class ReplayRecorder
+{
+public:
+    ReplayRecorder();
+
+    // Clears any previous recording
+    void Begin(uint32 level, uint64 seed, GeneratorPolicy policy);
+    void Record(uint64 tick, ReplayCode code, uint32 argument = 0);
+    // Closes the recording with the state of the game, nothing is recorded after it
+    void Finish(const Game& game);
+
+    bool IsFinished() const { return m_isFinished; }
+
+    const std::vector<uint8>& GetData() const { return m_data; }
+    bool Save(const char* filename) const;
+
+private:
+    void PutVarint(uint64 value);
+
+    std::vector<uint8> m_data;
+    uint64 m_lastTick;
+    bool m_isFinished;
+};
+
+// Rebuilds a recorded game by applying its inputs at their ticks. The game records itself again while
+// it plays and every byte has to match the original, so any difference is caught where it happens
+class ReplayPlayer
+{
+public:
+    ReplayPlayer();
+
+    bool Load(const char* filename);
+    // Checks the header and the records, false if the data is not a complete replay stream
+    bool Open(std::vector<uint8> data);
+
+    // Resets the game to the recorded start, the game must not have started yet
+    bool Start(Game* game);
+    // Applies the records up to tick and steps the game to it, false once the game went out of sync
+    bool Advance(uint64 tick);
+    // Plays the whole replay as fast as possible
+    bool Run(Game* game);
+
+    bool IsFinished() const { return m_position == m_data.size(); }
+    bool IsDesynced() const { return m_isDesynced; }
+    // Finished with every recorded byte reproduced
+    bool IsVerified() const { return IsFinished() && !m_isDesynced && m_verifier.GetData() == m_data; }
+
+    uint64 GetNextTick() const { return m_nextTick; }
+    uint64 GetEndTick() const { return m_endTick; }
+    uint64 GetDesyncTick() const { return m_desyncTick; }
+    uint32 GetRecordCount() const { return m_recordCount; }
+    uint64 GetSeed() const { return m_seed; }
+    uint32 GetLevel() const { return m_level; }
+    GeneratorPolicy GetPolicy() const { return m_policy; }
+    size_t GetSize() const { return m_data.size(); }
+
+private:
+    bool ReadVarint(size_t& position, uint64& value) const;
+    bool ReadRecord(size_t& position, uint64& tick, uint8& code, uint32& argument) const;
+    void PeekNextTick();
+    bool CheckVerifier();
+
+    std::vector<uint8> m_data;
+    size_t m_bodyStart;
+    size_t m_position;
+    size_t m_verifiedSize;
+
+    Game* m_game;
+    ReplayRecorder m_verifier;
+
+    uint64 m_seed;
+    uint32 m_level;
+    GeneratorPolicy m_policy;
+
+    uint64 m_tick;
+    uint64 m_nextTick;
+    uint64 m_endTick;
+    uint64 m_desyncTick;
+    uint32 m_recordCount;
+    bool m_isDesynced;
+};
+
+#endif
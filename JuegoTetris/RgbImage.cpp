@@ -23,10 +23,28 @@
 #endif
 
 #include "RgbImage.h"
+#include <string.h>
 
-#ifndef RGBIMAGE_DONT_USE_OPENGL
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// pshufb swizzle when the compiler targets SSSE3, a portable word swizzle otherwise
+#if defined(__SSSE3__) || (defined(_MSC_VER) && defined(__AVX__))
+#define RGBIMAGE_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#ifndef RGBIMAGE_DONT_USE_OPENGL
 #include "GL/gl.h"
+#ifndef GL_BGR
+#define GL_BGR 0x80E0
+#endif
 #endif
 
 RgbImage::RgbImage( int numRows, int numCols )
@@ -34,6 +52,9 @@ RgbImage::RgbImage( int numRows, int numCols )
 	NumRows = numRows;
 	NumCols = numCols;
     ErrorCode = NoError;
+	MappedPixels = 0;
+	MappedFile = 0;
+	MappedSize = 0;
 	ImagePtr = new unsigned char[NumRows*GetNumBytesPerRow()];
 	if ( !ImagePtr ) {
 		fprintf(stderr, "Unable to allocate memory for %ld x %ld bitmap.\n", 
@@ -69,23 +90,10 @@ bool RgbImage::LoadBmpFile( const char* filename )
 		return false;
 	}
 
-	bool fileFormatOK = false;
-	int bChar = fgetc( infile );
-	int mChar = fgetc( infile );
-	if ( bChar=='B' && mChar=='M' ) {			// If starts with "BM" for "BitMap"
-		skipChars( infile, 4+2+2+4+4 );			// Skip 4 fields we don't care about
-		NumCols = readLong( infile );
-		NumRows = readLong( infile );
-		skipChars( infile, 2 );					// Skip one field
-		int bitsPerPixel = readShort( infile );
-		skipChars( infile, 4+4+4+4+4+4 );		// Skip 6 more fields
-
-		if ( NumCols>0 && NumCols<=100000 && NumRows>0 && NumRows<=100000  
-			&& bitsPerPixel==24 && !feof(infile) ) {
-			fileFormatOK = true;
-		}
-	}
-	if ( !fileFormatOK ) {
+	// Both headers in a single read
+	unsigned char header[BmpHeaderSize];
+	long dataOffset = BmpHeaderSize;
+	if ( fread( header, 1, BmpHeaderSize, infile )!=BmpHeaderSize || !parseHeader( header, &dataOffset ) ) {
 		Reset();
 		ErrorCode = FileFormatError;
 		fprintf(stderr, "Not a valid 24-bit bitmap file: %s.\n", filename);
@@ -104,22 +112,10 @@ bool RgbImage::LoadBmpFile( const char* filename )
 		return false;
 	}
 
-	unsigned char* cPtr = ImagePtr;
-	for ( int i=0; i<NumRows; i++ ) {
-		int j;
-		for ( j=0; j<NumCols; j++ ) {
-			*(cPtr+2) = fgetc( infile );	// Blue color value
-			*(cPtr+1) = fgetc( infile );	// Green color value
-			*cPtr = fgetc( infile );		// Red color value
-			cPtr += 3;
-		}
-		int k=3*NumCols;					// Num bytes already read
-		for ( ; k<GetNumBytesPerRow(); k++ ) {
-			fgetc( infile );				// Read and ignore padding;
-			*(cPtr++) = 0;
-		}
-	}
-	if ( feof( infile ) ) {
+	// Rows in the file are padded to four bytes like ours, so the whole pixel array is read at once
+	size_t dataSize = size_t(NumRows)*GetNumBytesPerRow();
+	if ( (dataOffset!=BmpHeaderSize && fseek( infile, dataOffset, SEEK_SET )!=0)
+		|| fread( ImagePtr, 1, dataSize, infile )!=dataSize ) {
 		fprintf( stderr, "Premature end of file: %s.\n", filename );
 		Reset();
 		ErrorCode = ReadError;
@@ -127,48 +123,164 @@ bool RgbImage::LoadBmpFile( const char* filename )
 		return false;
 	}
 	fclose( infile );	// Close the file
+
+	int rowLen = GetNumBytesPerRow();
+	for ( long i=0; i<NumRows; i++ ) {
+		unsigned char* row = ImagePtr + i*rowLen;
+		swapRedBlue( row, NumCols );
+		for ( int k=3*NumCols; k<rowLen; k++ ) {
+			row[k] = 0;						// Padding
+		}
+	}
+	return true;
+}
+
+/* ********************************************************************
+ *  MapBmpFile
+ *  Map an uncompressed BMP file into memory, read only. The pixel rows
+ *     are left as stored (BGR, bottom up, padded to four bytes) and
+ *     are available with MappedData until Reset.
+ *  Return true for success, false for failure.
+ **********************************************************************/
+
+bool RgbImage::MapBmpFile( const char* filename )
+{
+	Reset();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+	if ( file==INVALID_HANDLE_VALUE ) {
+		fprintf(stderr, "Unable to open file: %s\n", filename);
+		ErrorCode = OpenError;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = 0;
+	if ( GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart>=BmpHeaderSize ) {
+		mapping = CreateFileMappingA( file, 0, PAGE_READONLY, 0, 0, 0 );
+	}
+	if ( mapping ) {
+		MappedFile = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		MappedSize = (size_t)fileSize.QuadPart;
+		CloseHandle( mapping );		// The view keeps the mapping alive
+	}
+	CloseHandle( file );
+#else
+	int file = open( filename, O_RDONLY );
+	if ( file<0 ) {
+		fprintf(stderr, "Unable to open file: %s\n", filename);
+		ErrorCode = OpenError;
+		return false;
+	}
+	struct stat fileInfo;
+	if ( fstat( file, &fileInfo )==0 && fileInfo.st_size>=BmpHeaderSize ) {
+		void* view = mmap( 0, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+		if ( view!=MAP_FAILED ) {
+			MappedFile = view;
+			MappedSize = (size_t)fileInfo.st_size;
+		}
+	}
+	close( file );					// The mapping stays valid
+#endif
+
+	if ( !MappedFile ) {
+		Reset();
+		ErrorCode = ReadError;
+		fprintf(stderr, "Unable to map file: %s.\n", filename);
+		return false;
+	}
+
+	const unsigned char* data = (const unsigned char*)MappedFile;
+	long dataOffset = BmpHeaderSize;
+	if ( !parseHeader( data, &dataOffset ) ) {
+		Reset();
+		ErrorCode = FileFormatError;
+		fprintf(stderr, "Not a valid 24-bit bitmap file: %s.\n", filename);
+		return false;
+	}
+	if ( MappedSize<(size_t)dataOffset+(size_t)NumRows*GetNumBytesPerRow() ) {
+		Reset();
+		ErrorCode = ReadError;
+		fprintf( stderr, "Premature end of file: %s.\n", filename );
+		return false;
+	}
+
+	MappedPixels = data+dataOffset;
 	return true;
 }
 
-short RgbImage::readShort( FILE* infile )
+void RgbImage::unmapFile()
 {
-	// read a 16 bit integer
-	unsigned char lowByte, hiByte;
-	lowByte = fgetc(infile);			// Read the low order byte (little endian form)
-	hiByte = fgetc(infile);			// Read the high order byte
-
-	// Pack together
-	short ret = hiByte;
-	ret <<= 8;
-	ret |= lowByte;
-	return ret;
+	if ( MappedFile ) {
+#ifdef _WIN32
+		UnmapViewOfFile( MappedFile );
+#else
+		munmap( MappedFile, MappedSize );
+#endif
+	}
+	MappedFile = 0;
+	MappedPixels = 0;
+	MappedSize = 0;
 }
 
-long RgbImage::readLong( FILE* infile )
-{  
-	// Read in 32 bit integer
-	unsigned char byte0, byte1, byte2, byte3;
-	byte0 = fgetc(infile);			// Read bytes, low order to high order
-	byte1 = fgetc(infile);
-	byte2 = fgetc(infile);
-	byte3 = fgetc(infile);
-
-	// Pack together
-	long ret = byte3;
-	ret <<= 8;
-	ret |= byte2;
-	ret <<= 8;
-	ret |= byte1;
-	ret <<= 8;
-	ret |= byte0;
-	return ret;
+// Reads the size from the 54 byte header, false unless it is a 24 bit bitmap
+bool RgbImage::parseHeader( const unsigned char* header, long* dataOffset )
+{
+	if ( header[0]!='B' || header[1]!='M' ) {	// If starts with "BM" for "BitMap"
+		return false;
+	}
+	*dataOffset = getLong( header+10 );
+	NumCols = getLong( header+18 );
+	NumRows = getLong( header+22 );
+	int bitsPerPixel = getShort( header+28 );
+
+	return ( NumCols>0 && NumCols<=100000 && NumRows>0 && NumRows<=100000
+		&& bitsPerPixel==24 && *dataOffset>=BmpHeaderSize );
 }
 
-void RgbImage::skipChars( FILE* infile, int numChars )
+// Swaps the first and third byte of each 3 byte pixel, BGR <-> RGB
+void RgbImage::swapRedBlue( unsigned char* pixels, long numPixels )
 {
-	for ( int i=0; i<numChars; i++ ) {
-		fgetc( infile );
+	unsigned char* cPtr = pixels;
+	unsigned char* end = pixels + 3*numPixels;
+
+#ifdef RGBIMAGE_USE_SSSE3
+	// Five pixels per shuffle, the sixteenth byte is left as it was
+	const __m128i mask = _mm_setr_epi8( 2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, 15 );
+	for ( ; end-cPtr>=16; cPtr+=15 ) {
+		__m128i data = _mm_loadu_si128( (const __m128i*)cPtr );
+		_mm_storeu_si128( (__m128i*)cPtr, _mm_shuffle_epi8( data, mask ) );
 	}
+#else
+	// Four pixels as three little endian words
+	for ( ; end-cPtr>=12; cPtr+=12 ) {
+		unsigned int w[3];
+		memcpy( w, cPtr, 12 );
+		unsigned int o[3];
+		o[0] = ((w[0]>>16)&0xff) | (w[0]&0xff00) | ((w[0]&0xff)<<16) | ((w[1]&0xff00)<<16);
+		o[1] = (w[1]&0xff) | ((w[0]>>24)<<8) | ((w[2]&0xff)<<16) | (w[1]&0xff000000);
+		o[2] = ((w[1]>>16)&0xff) | ((w[2]>>24)<<8) | (w[2]&0xff0000) | ((w[2]&0xff00)<<16);
+		memcpy( cPtr, o, 12 );
+	}
+#endif
+
+	for ( ; cPtr<end; cPtr+=3 ) {
+		unsigned char blue = cPtr[0];
+		cPtr[0] = cPtr[2];
+		cPtr[2] = blue;
+	}
+}
+
+short RgbImage::getShort( const unsigned char* data )
+{
+	// 16 bit little endian integer
+	return (short)(data[0] | (data[1]<<8));
+}
+
+long RgbImage::getLong( const unsigned char* data )
+{  
+	// 32 bit little endian integer
+	return (long)(int)((unsigned int)data[0] | ((unsigned int)data[1]<<8) | ((unsigned int)data[2]<<16) | ((unsigned int)data[3]<<24));
 }
 
 /* ********************************************************************
@@ -181,79 +293,74 @@ void RgbImage::skipChars( FILE* infile, int numChars )
 
 bool RgbImage::WriteBmpFile( const char* filename )
 {
-	FILE* outfile = fopen( filename, "wb" );		// Open for reading binary data
+	if ( !ImagePtr ) {
+		ErrorCode = WriteError;
+		return false;
+	}
+
+	// BMP rows are BGR, swizzle a copy so the file is written in one go
+	size_t dataSize = size_t(NumRows)*GetNumBytesPerRow();
+	unsigned char* bgrRows = new unsigned char[dataSize];
+	memcpy( bgrRows, ImagePtr, dataSize );
+	for ( long i=0; i<NumRows; i++ ) {
+		swapRedBlue( bgrRows + i*GetNumBytesPerRow(), NumCols );
+	}
+
+	bool ok = WriteBgrBmpFile( filename, NumRows, NumCols, bgrRows );
+	delete[] bgrRows;
+	if ( !ok ) {
+		ErrorCode = WriteError;
+	}
+	return ok;
+}
+
+// Rows bottom up, BGR and padded to four bytes, exactly as they are stored in the file
+bool RgbImage::WriteBgrBmpFile( const char* filename, long numRows, long numCols, const void* bgrRows )
+{
+	FILE* outfile = fopen( filename, "wb" );		// Open for writing binary data
 	if ( !outfile ) {
 		fprintf(stderr, "Unable to open file: %s\n", filename);
-		ErrorCode = OpenError;
 		return false;
 	}
 
-	fputc('B',outfile);
-	fputc('M',outfile);
-	int rowLen = GetNumBytesPerRow();
-	writeLong( 40+14+NumRows*rowLen, outfile );	// Length of file
-	writeShort( 0, outfile );					// Reserved for future use
-	writeShort( 0, outfile );
-	writeLong( 40+14, outfile );				// Offset to pixel data
-	writeLong( 40, outfile );					// header length
-	writeLong( NumCols, outfile );				// width in pixels
-	writeLong( NumRows, outfile );				// height in pixels (pos for bottom up)
-	writeShort( 1, outfile );		// number of planes
-	writeShort( 24, outfile );		// bits per pixel
-	writeLong( 0, outfile );		// no compression
-	writeLong( 0, outfile );		// not used if no compression
-	writeLong( 0, outfile );		// Pixels per meter
-	writeLong( 0, outfile );		// Pixels per meter
-	writeLong( 0, outfile );		// unused for 24 bits/pixel
-	writeLong( 0, outfile );		// unused for 24 bits/pixel
-
-	// Now write out the pixel data:
-	unsigned char* cPtr = ImagePtr;
-	for ( int i=0; i<NumRows; i++ ) {
-		// Write out i-th row's data
-		int j;
-		for ( j=0; j<NumCols; j++ ) {
-			fputc( *(cPtr+2), outfile);		// Blue color value
-			fputc( *(cPtr+1), outfile);		// Blue color value
-			fputc( *(cPtr+0), outfile);		// Blue color value
-			cPtr+=3;
-		}
-		// Pad row to word boundary
-		int k=3*NumCols;					// Num bytes already read
-		for ( ; k<GetNumBytesPerRow(); k++ ) {
-			fputc( 0, outfile );				// Read and ignore padding;
-			cPtr++;
-		}
+	int rowLen = ((3*numCols+3)>>2)<<2;
+	unsigned char header[BmpHeaderSize];
+	memset( header, 0, BmpHeaderSize );
+	header[0] = 'B';
+	header[1] = 'M';
+	putLong( header+2, BmpHeaderSize+numRows*rowLen );	// Length of file
+	putLong( header+10, BmpHeaderSize );			// Offset to pixel data
+	putLong( header+14, 40 );					// header length
+	putLong( header+18, numCols );				// width in pixels
+	putLong( header+22, numRows );				// height in pixels (pos for bottom up)
+	putShort( header+26, 1 );		// number of planes
+	putShort( header+28, 24 );		// bits per pixel
+												// No compression, sizes and colors unused
+
+	size_t dataSize = size_t(numRows)*rowLen;
+	bool ok = fwrite( header, 1, BmpHeaderSize, outfile )==BmpHeaderSize
+		&& fwrite( bgrRows, 1, dataSize, outfile )==dataSize;
+	ok = ( fclose( outfile )==0 ) && ok;	// Close the file
+	if ( !ok ) {
+		fprintf(stderr, "Unable to write file: %s\n", filename);
 	}
-
-	fclose( outfile );	// Close the file
-	return true;
+	return ok;
 }
 
-void RgbImage::writeLong( long data, FILE* outfile )
+void RgbImage::putLong( unsigned char* data, long value )
 {  
-	// Read in 32 bit integer
-	unsigned char byte0, byte1, byte2, byte3;
-	byte0 = (unsigned char)(data&0x000000ff);		// Write bytes, low order to high order
-	byte1 = (unsigned char)((data>>8)&0x000000ff);
-	byte2 = (unsigned char)((data>>16)&0x000000ff);
-	byte3 = (unsigned char)((data>>24)&0x000000ff);
-
-	fputc( byte0, outfile );
-	fputc( byte1, outfile );
-	fputc( byte2, outfile );
-	fputc( byte3, outfile );
+	// 32 bit little endian integer
+	data[0] = (unsigned char)(value&0x000000ff);
+	data[1] = (unsigned char)((value>>8)&0x000000ff);
+	data[2] = (unsigned char)((value>>16)&0x000000ff);
+	data[3] = (unsigned char)((value>>24)&0x000000ff);
 }
 
-void RgbImage::writeShort( short data, FILE* outfile )
+void RgbImage::putShort( unsigned char* data, short value )
 {  
-	// Read in 32 bit integer
-	unsigned char byte0, byte1;
-	byte0 = data&0x000000ff;		// Write bytes, low order to high order
-	byte1 = (data>>8)&0x000000ff;
-
-	fputc( byte0, outfile );
-	fputc( byte1, outfile );
+	// 16 bit little endian integer
+	data[0] = (unsigned char)(value&0x00ff);
+	data[1] = (unsigned char)((value>>8)&0x00ff);
 }
 
 
@@ -353,4 +460,26 @@ bool RgbImage::LoadFromOpenglBuffer()					// Load the bitmap from the current Op
 	return true;
 }
 
+bool RgbImage::TexImage2D() const
+{
+	const void* pixels = IsMapped() ? (const void*)MappedPixels : (const void*)ImagePtr;
+	if ( !pixels ) {
+		return false;
+	}
+
+	// Rows are padded to four bytes and tightly follow each other
+	int oldAlignment, oldRowLength;
+	glGetIntegerv( GL_UNPACK_ALIGNMENT, &oldAlignment );
+	glGetIntegerv( GL_UNPACK_ROW_LENGTH, &oldRowLength );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, NumCols );
+
+	// GL swizzles the mapped BGR rows itself, no copy is made on our side
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, NumCols, NumRows, 0, IsMapped() ? GL_BGR : GL_RGB, GL_UNSIGNED_BYTE, pixels );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, oldAlignment );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, oldRowLength );
+	return true;
+}
+
 #endif   // RGBIMAGE_DONT_USE_OPENGL
@@ -36,9 +36,12 @@ public:
 	~RgbImage();
 
 	bool LoadBmpFile( const char *filename );		// Loads the bitmap from the specified file
+	bool MapBmpFile( const char *filename );		// Maps the file read only, pixels stay BGR in the mapping
 	bool WriteBmpFile( const char* filename );		// Write the bitmap to the specified file
+	static bool WriteBgrBmpFile( const char* filename, long numRows, long numCols, const void* bgrRows );
 #ifndef RGBIMAGE_DONT_USE_OPENGL
 	bool LoadFromOpenglBuffer();					// Load the bitmap from the current OpenGL buffer
+	bool TexImage2D() const;						// glTexImage2D of level 0, straight from the mapping when mapped
 #endif
 
 	long GetNumRows() const { return NumRows; }
@@ -46,6 +49,9 @@ public:
 	// Rows are word aligned
 	long GetNumBytesPerRow() const { return ((3*NumCols+3)>>2)<<2; }	
 	const void* ImageData() const { return (void*)ImagePtr; }
+	// BGR rows of a mapped file, same padding as ImageData. The pixel accessors only work on loaded images
+	const void* MappedData() const { return (void*)MappedPixels; }
+	bool IsMapped() const { return (MappedPixels!=0); }
 
 	const unsigned char* GetRgbPixel( long row, long col ) const;
 	unsigned char* GetRgbPixel( long row, long col );
@@ -66,7 +72,7 @@ public:
 		ReadError = 4,			// End of file reached prematurely
 		WriteError = 5			// Unable to write out data (or no date to write out)
 	};
-	bool ImageLoaded() const { return (ImagePtr!=0); }  // Is an image loaded?
+	bool ImageLoaded() const { return (ImagePtr!=0 || MappedPixels!=0); }  // Is an image loaded?
 
 	void Reset();			// Frees image data memory
 
@@ -76,11 +82,20 @@ private:
 	long NumCols;				// number of columns in image
 	int ErrorCode;				// error code
 
-	static short readShort( FILE* infile );
-	static long readLong( FILE* infile );
-	static void skipChars( FILE* infile, int numChars );
-	static void writeLong( long data, FILE* outfile );
-	static void writeShort( short data, FILE* outfile );
+	const unsigned char* MappedPixels;	// pixel array inside the mapping
+	void* MappedFile;			// whole mapped file
+	size_t MappedSize;
+
+	enum { BmpHeaderSize = 14+40 };			// File header and info header
+
+	bool parseHeader( const unsigned char* header, long* dataOffset );
+	void unmapFile();
+
+	static short getShort( const unsigned char* data );
+	static long getLong( const unsigned char* data );
+	static void swapRedBlue( unsigned char* pixels, long numPixels );
+	static void putLong( unsigned char* data, long value );
+	static void putShort( unsigned char* data, short value );
 	
 	static unsigned char doubleToUnsignedChar( double x );
 
@@ -92,6 +107,9 @@ inline RgbImage::RgbImage()
 	NumCols = 0;
 	ImagePtr = 0;
 	ErrorCode = 0;
+	MappedPixels = 0;
+	MappedFile = 0;
+	MappedSize = 0;
 }
 
 inline RgbImage::RgbImage( const char* filename )
@@ -100,12 +118,16 @@ inline RgbImage::RgbImage( const char* filename )
 	NumCols = 0;
 	ImagePtr = 0;
 	ErrorCode = 0;
+	MappedPixels = 0;
+	MappedFile = 0;
+	MappedSize = 0;
 	LoadBmpFile( filename );
 }
 
 inline RgbImage::~RgbImage()
 { 
 	delete[] ImagePtr;
+	unmapFile();
 }
 
 // Returned value points to three "unsigned char" values for R,G,B
@@ -154,6 +176,7 @@ inline void RgbImage::Reset()
 	delete[] ImagePtr;
 	ImagePtr = 0;
 	ErrorCode = 0;
+	unmapFile();
 }
 
 
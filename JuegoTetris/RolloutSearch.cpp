@@ -0,0 +1,150 @@
+#include "RolloutSearch.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+RolloutSearch::RolloutSearch(ThreadPool* pool /*= nullptr*/, const BoardEvaluator& evaluator /*= MakeWeightedEvaluator()*/)
+{
+    m_pool = pool;
+    m_budget = ROLLOUT_DEFAULT_BUDGET;
+    m_depth = ROLLOUT_DEFAULT_DEPTH;
+    m_random.Seed(DEFAULT_SEED);
+    m_candidateCount = 0;
+    m_next = TYPE_NONE;
+    m_policy = GENERATOR_NO_REPEAT;
+    m_seed = 0;
+    m_nextRollout = 0;
+    m_lastRolloutCount = 0;
+    m_rolloutCount = 0;
+    m_moveCount = 0;
+
+    // One greedy bot per worker, they keep their search buffers between moves and share the table
+    uint32 workers = pool ? pool->GetThreadCount() : 1;
+    for (uint32 i = 0; i < workers; i++)
+    {
+        m_bots.emplace_back(new Bot(evaluator));
+        m_bots.back()->SetTranspositionTable(&m_table);
+    }
+
+    m_stats.resize(workers);
+}
+
+uint32 RolloutSearch::Choose(const BotBoard& board, BlockType type, BlockType next, GeneratorPolicy policy,
+    const std::vector<Placement>& landings, const std::vector<float>& scores)
+{
+    PROFILE_SCOPE("RolloutSearch::Choose");
+
+    m_lastRolloutCount = 0;
+
+    // Best plain scores first, the losing placements are left out
+    std::vector<uint32> order(landings.size());
+    for (uint32 i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&scores](uint32 a, uint32 b) { return scores[a] > scores[b]; });
+
+    m_candidateCount = 0;
+    for (uint32 i = 0; i < order.size() && m_candidateCount < ROLLOUT_MAX_CANDIDATES && scores[order[i]] != BOT_LOST_SCORE; i++)
+    {
+        const Placement& landing = landings[order[i]];
+        BotBoard& placed = m_candidateBoards[m_candidateCount];
+        placed = board;
+        m_candidateLines[m_candidateCount] = placed.Place(GetBlockShape(type, landing.state.rotation), landing.state.x, landing.state.y);
+        m_candidates[m_candidateCount++] = order[i];
+    }
+
+    if (m_candidateCount < 2)
+        return order.empty() ? 0 : order[0];
+
+    m_next = next;
+    m_policy = policy;
+    m_seed = m_random.Next64();
+    m_nextRollout = 0;
+    m_deadline = Clock::now() + std::chrono::microseconds(m_budget);
+
+    if (m_pool)
+    {
+        for (uint32 i = 0; i < GetWorkerCount(); i++)
+            m_pool->Submit([this, i]() { RunWorker(i); });
+        m_pool->Wait();
+    }
+    else
+        RunWorker(0);
+
+    double sums[ROLLOUT_MAX_CANDIDATES] = {};
+    uint32 counts[ROLLOUT_MAX_CANDIDATES] = {};
+    for (const WorkerStats& stats : m_stats)
+    {
+        for (uint32 i = 0; i < m_candidateCount; i++)
+        {
+            sums[i] += stats.sums[i];
+            counts[i] += stats.counts[i];
+        }
+    }
+
+    // Candidates without rollouts keep their order, the first one wins if none got any
+    uint32 best = 0;
+    double bestMean = 0.0;
+    bool found = false;
+    for (uint32 i = 0; i < m_candidateCount; i++)
+    {
+        m_lastRolloutCount += counts[i];
+        if (!counts[i])
+            continue;
+
+        double mean = sums[i] / counts[i];
+        if (!found || mean > bestMean)
+        {
+            found = true;
+            best = i;
+            bestMean = mean;
+        }
+    }
+
+    m_rolloutCount += m_lastRolloutCount;
+    m_moveCount++;
+    return m_candidates[best];
+}
+
+void RolloutSearch::RunWorker(uint32 worker)
+{
+    Bot& bot = *m_bots[worker];
+    Random random(m_seed + worker * 0x9E3779B97F4A7C15ULL);
+
+    double sums[ROLLOUT_MAX_CANDIDATES] = {};
+    uint32 counts[ROLLOUT_MAX_CANDIDATES] = {};
+
+    // The shared counter only picks the candidate, so every candidate gets its share whichever worker is faster
+    while (Clock::now() < m_deadline)
+    {
+        uint32 candidate = uint32(m_nextRollout.fetch_add(1, std::memory_order_relaxed) % m_candidateCount);
+        sums[candidate] += Rollout(bot, random, candidate);
+        counts[candidate]++;
+    }
+
+    WorkerStats& stats = m_stats[worker];
+    for (uint32 i = 0; i < ROLLOUT_MAX_CANDIDATES; i++)
+    {
+        stats.sums[i] = sums[i];
+        stats.counts[i] = counts[i];
+    }
+}
+
+float RolloutSearch::Rollout(Bot& bot, Random& random, uint32 candidate) const
+{
+    BotBoard board = m_candidateBoards[candidate];
+    uint32 lines = m_candidateLines[candidate];
+
+    // The next block is known, the ones after it come from a generator with the policy of the game
+    PieceGenerator generator(random.Next64(), m_policy);
+    BlockType type = m_next != TYPE_NONE ? m_next : generator.Next();
+    for (uint32 i = 0; i <= m_depth; i++)
+    {
+        uint32 placedLines = 0;
+        if (bot.PlaceBest(board, type, placedLines) == BOT_LOST_SCORE)
+            return ROLLOUT_LOST_VALUE;
+
+        lines += placedLines;
+        type = generator.Next();
+    }
+
+    return bot.Evaluate(board, lines);
+}
@@ -0,0 +1,93 @@
+#ifndef ROLLOUT_SEARCH_H
+#define ROLLOUT_SEARCH_H
+
+#include "Common.h"
+#include "Bot.h"
+#include "PieceGenerator.h"
+#include "TranspositionTable.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+class ThreadPool;
+
+// Placements with the best plain scores that get rollouts
+#define ROLLOUT_MAX_CANDIDATES      8
+#define ROLLOUT_DEFAULT_BUDGET      5000
+// Blocks drawn after the known next one in each rollout
+#define ROLLOUT_DEFAULT_DEPTH       4
+// Value of a rollout that loses the game, far below any board the evaluator scores
+#define ROLLOUT_LOST_VALUE          -1000.0f
+
+// Deeper choice for the bot: plays random sequences of future blocks from each candidate placement with the
+// greedy bot and keeps the candidate with the best mean result. Rollouts run on every worker of the pool until
+// the time budget runs out, each worker sums its results on its own and they are merged once at the end.
+// The workers share a transposition table, so a board and block met again in any rollout is not searched twice.
+class RolloutSearch
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // Without a pool the rollouts run on the calling thread. Choose waits for the pool, so it can't be
+    // called from one of its workers
+    RolloutSearch(ThreadPool* pool = nullptr, const BoardEvaluator& evaluator = MakeWeightedEvaluator());
+
+    // Wall time spent on rollouts per move, in microseconds
+    void SetBudget(uint32 microseconds) { m_budget = microseconds; }
+    uint32 GetBudget() const { return m_budget; }
+
+    void SetDepth(uint32 depth) { m_depth = depth; }
+    uint32 GetDepth() const { return m_depth; }
+
+    void SetSeed(uint64 seed) { m_random.Seed(seed); }
+
+    // Index of the landing to play, given the plain score of each one
+    uint32 Choose(const BotBoard& board, BlockType type, BlockType next, GeneratorPolicy policy,
+        const std::vector<Placement>& landings, const std::vector<float>& scores);
+
+    uint32 GetWorkerCount() const { return uint32(m_bots.size()); }
+    uint64 GetLastRolloutCount() const { return m_lastRolloutCount; }
+    uint64 GetRolloutCount() const { return m_rolloutCount; }
+    uint64 GetMoveCount() const { return m_moveCount; }
+
+    TranspositionTable& GetTranspositionTable() { return m_table; }
+
+private:
+    // Written by a single worker once its rollouts are done, a cache line apart from the others
+    struct alignas(64) WorkerStats
+    {
+        double sums[ROLLOUT_MAX_CANDIDATES];
+        uint32 counts[ROLLOUT_MAX_CANDIDATES];
+    };
+
+    void RunWorker(uint32 worker);
+    float Rollout(Bot& bot, Random& random, uint32 candidate) const;
+
+    ThreadPool* m_pool;
+    TranspositionTable m_table;
+    std::vector<std::unique_ptr<Bot>> m_bots;
+    std::vector<WorkerStats> m_stats;
+
+    uint32 m_budget;
+    uint32 m_depth;
+    Random m_random;
+
+    // State of the move being searched, read only while the workers run
+    uint32 m_candidates[ROLLOUT_MAX_CANDIDATES];
+    BotBoard m_candidateBoards[ROLLOUT_MAX_CANDIDATES];
+    uint32 m_candidateLines[ROLLOUT_MAX_CANDIDATES];
+    uint32 m_candidateCount;
+    BlockType m_next;
+    GeneratorPolicy m_policy;
+    uint64 m_seed;
+    Clock::time_point m_deadline;
+
+    // Hands the rollouts out round robin between the candidates
+    std::atomic<uint64> m_nextRollout;
+
+    uint64 m_lastRolloutCount;
+    uint64 m_rolloutCount;
+    uint64 m_moveCount;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "ThreadPool.h"
+
+// Pool the calling thread works for and its index there, a thread belongs to one pool at most
+static thread_local const ThreadPool* workerPool = nullptr;
+static thread_local uint32 workerIndex = ThreadPool::NO_WORKER;
+
+ThreadPool::ThreadPool(uint32 threads /*= 0*/)
+{
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    m_threadCount = threads;
+    m_queued = 0;
+    m_pending = 0;
+    m_nextQueue = 0;
+    m_stopping = false;
+
+    for (uint32 i = 0; i < threads; i++)
+        m_queues.emplace_back(new WorkQueue());
+
+    m_threads.reserve(threads);
+    for (uint32 i = 0; i < threads; i++)
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+uint32 ThreadPool::GetWorkerIndex() const
+{
+    return workerPool == this ? workerIndex : NO_WORKER;
+}
+
+void ThreadPool::Submit(Task task)
+{
+    // Tasks spawned by a worker stay in its own queue, the rest are spread between all of them
+    uint32 index = GetWorkerIndex();
+    if (index == NO_WORKER)
+        index = m_nextQueue++ % GetThreadCount();
+
+    m_pending++;
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+        m_queued++;
+    }
+
+    // Taking the lock makes sure a worker about to sleep sees the new task or gets the notification
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wakeCondition.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCondition.wait(lock, [this]() { return m_pending == 0; });
+}
+
+bool ThreadPool::PopTask(uint32 index, Task& task)
+{
+    // Newest task of our own queue first
+    {
+        WorkQueue& queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_queued--;
+            return true;
+        }
+    }
+
+    // Then steal the oldest task of another worker
+    for (uint32 i = 1; i < GetThreadCount(); i++)
+    {
+        WorkQueue& queue = *m_queues[(index + i) % GetThreadCount()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::WorkerLoop(uint32 index)
+{
+    workerPool = this;
+    workerIndex = index;
+
+    Task task;
+    while (true)
+    {
+        if (!PopTask(index, task))
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this]() { return m_queued > 0 || m_stopping; });
+            if (m_stopping && m_queued == 0)
+                return;
+
+            continue;
+        }
+
+        task();
+        task = nullptr;
+
+        if (--m_pending == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_idleCondition.notify_all();
+        }
+    }
+}
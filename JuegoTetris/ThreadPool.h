@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "Common.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Fixed set of worker threads, each with its own task queue. Idle workers steal from the other queues.
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    // 0 threads uses one per hardware thread
+    ThreadPool(uint32 threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(Task task);
+    // Blocks until every submitted task has finished
+    void Wait();
+
+    uint32 GetThreadCount() const { return m_threadCount; }
+
+    // Index of the worker running the calling thread, NO_WORKER outside this pool, workers of other pools included
+    uint32 GetWorkerIndex() const;
+    static constexpr uint32 NO_WORKER = ~0u;
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void WorkerLoop(uint32 index);
+    bool PopTask(uint32 index, Task& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    uint32 m_threadCount;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_idleCondition;
+
+    std::atomic<uint32> m_queued;
+    std::atomic<uint32> m_pending;
+    std::atomic<uint32> m_nextQueue;
+    bool m_stopping;
+};
+
+#endif
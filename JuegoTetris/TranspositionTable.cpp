@@ -0,0 +1,125 @@
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable(size_t bytes /*= TRANSPOSITION_DEFAULT_SIZE*/)
+{
+    size_t buckets = 1;
+    while (buckets * 2 * sizeof(Bucket) <= bytes)
+        buckets *= 2;
+
+    m_buckets.reset(new Bucket[buckets]);
+    m_bucketMask = buckets - 1;
+    Clear();
+}
+
+void TranspositionTable::Clear()
+{
+    for (size_t i = 0; i <= m_bucketMask; i++)
+    {
+        for (Entry& entry : m_buckets[i].entries)
+        {
+            entry.check.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ResetCounters();
+}
+
+TranspositionTable::Counters& TranspositionTable::GetCounters()
+{
+    // Each thread takes the next slot the first time it counts, whichever pool it belongs to
+    static std::atomic<uint32> nextSlot(0);
+    static thread_local uint32 slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % TRANSPOSITION_COUNTER_SLOTS;
+    return m_counters[slot];
+}
+
+bool TranspositionTable::Probe(uint64 key, uint64& data)
+{
+    Counters& counters = GetCounters();
+    counters.probes.fetch_add(1, std::memory_order_relaxed);
+
+    for (Entry& entry : GetBucket(key).entries)
+    {
+        uint64 stored = entry.data.load(std::memory_order_relaxed);
+        uint64 check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ stored) == key && (check || stored))
+        {
+            counters.hits.fetch_add(1, std::memory_order_relaxed);
+            data = stored;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TranspositionTable::Store(uint64 key, uint64 data)
+{
+    GetCounters().stores.fetch_add(1, std::memory_order_relaxed);
+
+    // Same key first, then an empty entry, else the high bits of the key pick the one to replace
+    Bucket& bucket = GetBucket(key);
+    Entry* target = nullptr;
+    for (Entry& entry : bucket.entries)
+    {
+        uint64 stored = entry.data.load(std::memory_order_relaxed);
+        uint64 check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ stored) == key)
+        {
+            target = &entry;
+            break;
+        }
+
+        if (!target && !check && !stored)
+            target = &entry;
+    }
+
+    if (!target)
+        target = &bucket.entries[(key >> 32) % TRANSPOSITION_BUCKET_SIZE];
+
+    target->data.store(data, std::memory_order_relaxed);
+    target->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+uint64 TranspositionTable::GetProbeCount() const
+{
+    uint64 count = 0;
+    for (const Counters& counters : m_counters)
+        count += counters.probes.load(std::memory_order_relaxed);
+
+    return count;
+}
+
+uint64 TranspositionTable::GetHitCount() const
+{
+    uint64 count = 0;
+    for (const Counters& counters : m_counters)
+        count += counters.hits.load(std::memory_order_relaxed);
+
+    return count;
+}
+
+uint64 TranspositionTable::GetStoreCount() const
+{
+    uint64 count = 0;
+    for (const Counters& counters : m_counters)
+        count += counters.stores.load(std::memory_order_relaxed);
+
+    return count;
+}
+
+double TranspositionTable::GetHitRate() const
+{
+    uint64 probes = GetProbeCount();
+    return probes ? double(GetHitCount()) / double(probes) : 0.0;
+}
+
+void TranspositionTable::ResetCounters()
+{
+    for (Counters& counters : m_counters)
+    {
+        counters.probes.store(0, std::memory_order_relaxed);
+        counters.hits.store(0, std::memory_order_relaxed);
+        counters.stores.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include "Common.h"
+#include <atomic>
+#include <memory>
+
+#define TRANSPOSITION_DEFAULT_SIZE  (16 << 20)
+// Entries of 16 bytes in a bucket of one cache line, a probe reads a single line
+#define TRANSPOSITION_BUCKET_SIZE   4
+// Hit counters kept apart per thread, threads beyond the first 16 share slots
+#define TRANSPOSITION_COUNTER_SLOTS 16
+
+// Fixed size hash table of 64 bit results keyed by 64 bit Zobrist hashes, shared by search threads without locks.
+// Each entry stores the key xored with the data, an entry torn by two threads writing at once fails the
+// key check and reads as a miss instead of returning the data of another position
+class TranspositionTable
+{
+public:
+    // Size in bytes, rounded down to a power of two of buckets
+    TranspositionTable(size_t bytes = TRANSPOSITION_DEFAULT_SIZE);
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // Empties the table and the counters, not while other threads use it
+    void Clear();
+
+    // True and the stored data if the key is in the table. A zero key with zero data is an empty entry
+    bool Probe(uint64 key, uint64& data);
+    // Replaces the entry of the key, an empty one or else the one the key picks in its bucket
+    void Store(uint64 key, uint64 data);
+
+    size_t GetEntryCount() const { return (m_bucketMask + 1) * TRANSPOSITION_BUCKET_SIZE; }
+
+    uint64 GetProbeCount() const;
+    uint64 GetHitCount() const;
+    uint64 GetStoreCount() const;
+    // Hits per probe, 0 before the first probe
+    double GetHitRate() const;
+    void ResetCounters();
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64> check;
+        std::atomic<uint64> data;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Entry entries[TRANSPOSITION_BUCKET_SIZE];
+    };
+
+    struct alignas(64) Counters
+    {
+        std::atomic<uint64> probes;
+        std::atomic<uint64> hits;
+        std::atomic<uint64> stores;
+    };
+
+    Bucket& GetBucket(uint64 key) { return m_buckets[key & m_bucketMask]; }
+    Counters& GetCounters();
+
+    std::unique_ptr<Bucket[]> m_buckets;
+    size_t m_bucketMask;
+    Counters m_counters[TRANSPOSITION_COUNTER_SLOTS];
+};
+
+#endif
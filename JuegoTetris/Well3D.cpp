@@ -0,0 +1,162 @@
+#include "Well3D.h"
+#include <cstring>
+
+Well3D::Well3D()
+{
+    m_width = 0;
+    m_depth = 0;
+    m_height = 0;
+    m_layerCount = 0;
+    m_fullLayerMask = 0;
+    Init(DEFAULT_WELL_WIDTH, DEFAULT_WELL_DEPTH, DEFAULT_WELL_HEIGHT);
+}
+
+bool Well3D::IsValidSize(int32 width, int32 depth, int32 height)
+{
+    // The flat spawn orientation needs four columns, and four layers to turn upright
+    return width >= NUM_BLOCK_SUBBLOCKS && depth >= 1 && width * depth <= WELL_MAX_LAYER_CELLS &&
+        height >= NUM_BLOCK_SUBBLOCKS && height + WELL_HIDDEN_LAYERS <= WELL_MAX_LAYERS;
+}
+
+bool Well3D::Init(int32 width, int32 depth, int32 height)
+{
+    if (!IsValidSize(width, depth, height))
+    {
+        DEBUG_LOG("Invalid well size %d x %d x %d\n", width, depth, height);
+        return false;
+    }
+
+    m_width = width;
+    m_depth = depth;
+    m_height = height;
+    m_layerCount = height + WELL_HIDDEN_LAYERS;
+    m_fullLayerMask = width * depth == WELL_MAX_LAYER_CELLS ? ~0ull : (1ull << (width * depth)) - 1;
+
+    BuildShapes();
+    Clear();
+    return true;
+}
+
+void Well3D::Clear()
+{
+    memset(m_layers, 0, sizeof(m_layers));
+    memset(m_colors, 0, sizeof(m_colors));
+}
+
+void Well3D::BuildShapes()
+{
+    // The masks depend on the row stride, so each well builds them for its own width
+    for (uint8 type = 0; type < MAX_BLOCK_TYPE; type++)
+    {
+        for (uint8 orientation = 0; orientation < NUM_ORIENTATIONS; orientation++)
+        {
+            const BlockShape3D& source = GetBlockShape3D(BlockType(type), orientation);
+            WellShape& shape = m_shapes[type][orientation];
+            shape.minX = source.minX;
+            shape.maxX = source.maxX;
+            shape.minY = source.minY;
+            shape.maxY = source.maxY;
+            shape.minZ = source.minZ;
+            shape.maxZ = source.maxZ;
+
+            for (uint8 i = 0; i < NUM_BLOCK_SUBBLOCKS; i++)
+                shape.layerMasks[i] = 0;
+
+            for (const Position3D& cell : source.cells)
+                shape.layerMasks[cell.y - source.minY] |= 1ull << ((cell.z - source.minZ) * m_width + cell.x - source.minX);
+        }
+    }
+}
+
+bool Well3D::Collides(BlockType type, uint8 orientation, int32 x, int32 y, int32 z) const
+{
+    const WellShape& shape = GetShape(type, orientation);
+    int32 left = x + shape.minX;
+    int32 front = z + shape.minZ;
+    int32 bottom = y + shape.minY;
+    if (left < 0 || x + shape.maxX >= m_width || front < 0 || z + shape.maxZ >= m_depth || bottom < 0)
+        return true;
+
+    // Inside the walls the shifted masks never wrap to the next row. Layers above the well are always empty
+    uint32 shift = uint32(front * m_width + left);
+    for (int32 i = 0; i <= shape.maxY - shape.minY; i++)
+        if (GetLayerMask(bottom + i) & (shape.layerMasks[i] << shift))
+            return true;
+
+    return false;
+}
+
+int32 Well3D::GetDropDistance(BlockType type, uint8 orientation, int32 x, int32 y, int32 z) const
+{
+    int32 distance = 0;
+    while (!Collides(type, orientation, x, y - distance - 1, z))
+        distance++;
+
+    return distance;
+}
+
+void Well3D::SetCell(int32 x, int32 y, int32 z, Color color)
+{
+    if (!IsInside(x, y, z))
+    {
+        DEBUG_LOG("Cell out of well in position X: %d, Y: %d, Z: %d\n", x, y, z);
+        return;
+    }
+
+    m_layers[y] |= GetCellBit(x, z);
+    m_colors[y][z * m_width + x] = uint8(color);
+}
+
+void Well3D::Lock(BlockType type, uint8 orientation, int32 x, int32 y, int32 z, Color color)
+{
+    for (const Position3D& cell : GetBlockShape3D(type, orientation).cells)
+        SetCell(x + cell.x, y + cell.y, z + cell.z, color);
+}
+
+uint32 Well3D::GetFullLayers() const
+{
+    uint32 layers = 0;
+    for (int32 y = 0; y < m_layerCount; y++)
+        if (m_layers[y] == m_fullLayerMask)
+            layers |= 1u << y;
+
+    return layers;
+}
+
+uint32 Well3D::ClearLayers(uint32 layers)
+{
+    if (!layers)
+        return 0;
+
+    // Whole layers move, a mask and one row of colors each
+    int32 target = 0;
+    for (int32 y = 0; y < m_layerCount; y++)
+    {
+        if (layers & (1u << y))
+            continue;
+
+        if (target != y)
+        {
+            m_layers[target] = m_layers[y];
+            memcpy(m_colors[target], m_colors[y], sizeof(m_colors[y]));
+        }
+        target++;
+    }
+
+    for (; target < m_layerCount; target++)
+    {
+        m_layers[target] = 0;
+        memset(m_colors[target], 0, sizeof(m_colors[target]));
+    }
+
+    return CountBits(layers);
+}
+
+int32 Well3D::GetStackHeight() const
+{
+    int32 y = m_layerCount;
+    while (y > 0 && !m_layers[y - 1])
+        y--;
+
+    return y;
+}
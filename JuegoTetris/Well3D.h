@@ -0,0 +1,84 @@
+#ifndef WELL_3D_H
+#define WELL_3D_H
+
+#include "Common.h"
+#include "BlockShapes3D.h"
+
+// Extra layers above the well, a new active block is spawned there
+#define WELL_HIDDEN_LAYERS          4
+// Layers are indexed by the bits of a uint32 in the full layer masks
+#define WELL_MAX_LAYERS             32
+// Cells of a layer, one bit each in a uint64
+#define WELL_MAX_LAYER_CELLS        64
+
+constexpr int32 DEFAULT_WELL_WIDTH  = 5;
+constexpr int32 DEFAULT_WELL_DEPTH  = 5;
+constexpr int32 DEFAULT_WELL_HEIGHT = 12;
+
+// A block orientation as masks for a well: bit (z * width + x) of layerMasks[i] is the cell (minX + x, minY + i, minZ + z)
+struct WellShape
+{
+    int8 minX, maxX, minY, maxY, minZ, maxZ;
+    uint64 layerMasks[NUM_BLOCK_SUBBLOCKS];
+};
+
+// Packed 3D playfield: each horizontal layer is one 64 bit occupancy mask, so collisions are an AND per
+// layer of the block and a full layer is a single compare. A parallel plane keeps the color of each cell.
+class Well3D
+{
+public:
+    Well3D();
+
+    // Width * depth must fit in a layer mask and the height, hidden layers included, in WELL_MAX_LAYERS
+    static bool IsValidSize(int32 width, int32 depth, int32 height);
+    bool Init(int32 width, int32 depth, int32 height);
+    void Clear();
+
+    int32 GetWidth() const { return m_width; }
+    int32 GetDepth() const { return m_depth; }
+    // Visible layers, blocks locked above them end the game
+    int32 GetHeight() const { return m_height; }
+    int32 GetLayerCount() const { return m_layerCount; }
+
+    bool IsInside(int32 x, int32 y, int32 z) const { return x >= 0 && x < m_width && y >= 0 && y < m_layerCount && z >= 0 && z < m_depth; }
+    bool IsOccupied(int32 x, int32 y, int32 z) const { return IsInside(x, y, z) && (m_layers[y] & GetCellBit(x, z)) != 0; }
+    Color GetCellColor(int32 x, int32 y, int32 z) const { return Color(m_colors[y][z * m_width + x]); }
+
+    uint64 GetCellBit(int32 x, int32 z) const { return 1ull << (z * m_width + x); }
+    uint64 GetLayerMask(int32 y) const { return (y >= 0 && y < m_layerCount) ? m_layers[y] : 0; }
+    uint64 GetFullLayerMask() const { return m_fullLayerMask; }
+
+    const WellShape& GetShape(BlockType type, uint8 orientation) const { return m_shapes[type][orientation % NUM_ORIENTATIONS]; }
+
+    // True if the block placed with its origin in (x, y, z) leaves the walls/floor or overlaps a filled cell
+    bool Collides(BlockType type, uint8 orientation, int32 x, int32 y, int32 z) const;
+    // Layers the block can fall from (x, y, z) before it rests on the floor or the stack
+    int32 GetDropDistance(BlockType type, uint8 orientation, int32 x, int32 y, int32 z) const;
+    void SetCell(int32 x, int32 y, int32 z, Color color);
+    // Fills the cells of the block, the ones above the top layer are lost
+    void Lock(BlockType type, uint8 orientation, int32 x, int32 y, int32 z, Color color);
+
+    // Bit y set for every full layer
+    uint32 GetFullLayers() const;
+    // Removes the given layers and moves the ones above down in a single pass, returns the number of layers removed
+    uint32 ClearLayers(uint32 layers);
+
+    // Highest layer with a filled cell plus one, 0 for an empty well
+    int32 GetStackHeight() const;
+
+private:
+    void BuildShapes();
+
+    int32 m_width;
+    int32 m_depth;
+    int32 m_height;
+    int32 m_layerCount;
+    uint64 m_fullLayerMask;
+
+    uint64 m_layers[WELL_MAX_LAYERS];
+    uint8 m_colors[WELL_MAX_LAYERS][WELL_MAX_LAYER_CELLS];
+
+    WellShape m_shapes[MAX_BLOCK_TYPE][NUM_ORIENTATIONS];
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "Common.h"
+#include "Board.h"
+#include "Random.h"
+
+// Most rows a single block can complete
+#define ZOBRIST_MAX_LINES           NUM_BLOCK_SUBBLOCKS
+
+// Random 64 bit keys, a position hashes to the xor of the keys of everything in it so locking, clearing or
+// spawning only xors the keys that change
+struct ZobristTable
+{
+    uint64 cells[BOARD_HEIGHT][BOARD_WIDTH];
+    uint64 activeBlocks[MAX_BLOCK_TYPE];
+    uint64 nextBlocks[MAX_BLOCK_TYPE];
+    uint64 lines[ZOBRIST_MAX_LINES + 1];
+};
+
+constexpr ZobristTable MakeZobristTable()
+{
+    ZobristTable table = {};
+    Random random(0x2AB0B15754B1E5ULL);
+    for (int32 y = 0; y < BOARD_HEIGHT; y++)
+        for (int32 x = 0; x < BOARD_WIDTH; x++)
+            table.cells[y][x] = random.Next64();
+
+    // No block and no lines leave the hash as it is
+    for (uint8 type = TYPE_NONE + 1; type < MAX_BLOCK_TYPE; type++)
+    {
+        table.activeBlocks[type] = random.Next64();
+        table.nextBlocks[type] = random.Next64();
+    }
+
+    for (uint32 lines = 1; lines <= ZOBRIST_MAX_LINES; lines++)
+        table.lines[lines] = random.Next64();
+
+    return table;
+}
+
+// Built at compile time with a fixed seed, so hashes match between runs and builds
+constexpr ZobristTable ZOBRIST_KEYS = MakeZobristTable();
+
+inline uint64 GetZobristCellKey(int32 x, int32 y) { return ZOBRIST_KEYS.cells[y][x]; }
+inline uint64 GetZobristActiveKey(BlockType type) { return ZOBRIST_KEYS.activeBlocks[type]; }
+inline uint64 GetZobristNextKey(BlockType type) { return ZOBRIST_KEYS.nextBlocks[type]; }
+inline uint64 GetZobristLinesKey(uint32 lines) { return ZOBRIST_KEYS.lines[lines]; }
+
+// Hash of the filled cells of BOARD_HEIGHT row masks, the same value Board keeps up to date
+inline uint64 HashRowMasks(const uint16* rowMasks)
+{
+    uint64 hash = 0;
+    for (int32 y = 0; y < BOARD_HEIGHT; y++)
+        for (uint32 row = rowMasks[y]; row; row &= row - 1)
+            hash ^= ZOBRIST_KEYS.cells[y][CountTrailingZeros(row)];
+
+    return hash;
+}
+
+#endif
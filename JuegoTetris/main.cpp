@@ -1,21 +1,59 @@
 #pragma once
 
+#ifdef _WIN32
+#include <Windows.h>
+#include <mmsystem.h>
+#define PlaySoundTetris PlaySound
+#undef max
+#else
+// No audio backend outside Windows
+#define TEXT(text) text
+#define SND_LOOP    0
+#define SND_ASYNC   0
+#define SND_MEMORY  0
+#define PlaySoundTetris(sound, module, flags) ((void)0)
+#endif //_WIN32
+
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 #include "Common.h"
+#include "AssetLoader.h"
 #include "Block.h"
+#include "Bot.h"
+#include "BoardRenderer.h"
+#include "FrameCapture.h"
 #include "Game.h"
+#include "Game3D.h"
+#include "Profiler.h"
+#include "RealTimeDriver.h"
+#include "Replay.h"
 #include "RgbImage.h"
+#include "RolloutSearch.h"
+#include "ThreadPool.h"
+#include <cstring>
 
 #define SCREEN_SIZE     1000, 500
 #define SCREEN_POSITION 800,  400
 #define SCREEN_COLOR     0.0, 0.0, 0.0, 0.0
 #define DOUBLE_CLICK_TIME 250
+#define DEFAULT_FRAME_CAP 60
+#define IDLE_TIMER_DELAY  250
+#define PROFILE_WINDOW    1000000000ull
+#define PROFILE_Y         (POINTS_Y - 3.0f)
+#define TRACE_FILENAME    "tetris_trace.json"
+#define ASSET_POLL_DELAY  16
+#define MUSIC_FILENAME    "../src/main.wav"
+#define CAPTURE_BMP_PREFIX "tetris_frame_"
+#define CAPTURE_Y4M_FILENAME "tetris_capture.y4m"
+#define MAX_REPLAY_SPEED  64
+#define WELL_TILT         35.0f
+#define BOT_ACTION_DELAY  60
 
 void initFunc();
 void funReshape(int w, int h);
 void funDisplay();
-void funIdle();
+void funTimer(int value);
+void funClose();
 void funKeyboardUp(unsigned char key, int x, int y);
 void funSpecial(int key, int x, int y);
 void funMouse(int key, int state, int x, int y);
@@ -24,18 +62,32 @@ void funMotionPassive(int x, int y);
 void funMouseWheel(int wheel, int direction, int x, int y);
 void drawFrame();
 void drawPanel();
+void buildPanel();
 void drawBlocks();
+void drawWell();
+void drawWellEdges(const Well3D& well);
 void drawPause();
 void drawPlane(GLfloat size);
-void drawBlock(Block* block);
-void drawSubBlock(SubBlock* sub);
-void drawBasicBlock(bool withBorder = true);
 void initLights();
 void initTextures();
-void selectColor(uint8 color);
+void pollAssets();
+void uploadTexture(uint32 index, const RgbImage& image);
+void playMusic();
 void generateRandomBlock();
 void renderText(float x, float y, void *font, const unsigned char* string);
 void drawPoints();
+void drawProfiler();
+void togglePause();
+void requestRedraw();
+void checkGameEvents();
+uint32 getTimerDelay();
+uint32 getCaptureFps();
+void toggleCapture();
+bool handleReplayKey(unsigned char key);
+bool handleWellKey(unsigned char key);
+void stepWell();
+void stepBot();
+void saveRecording();
 
 GLfloat cameraPos[3]            = { 2.0, 3.0, 10.0 };
 GLfloat lookat[3]               = { 2.0, 3.0, -8.0 };
@@ -45,26 +97,102 @@ GLfloat currentRotationZ        = 0.0;
 
 GLfloat ambientLightIntensity[]   = { 0.2f, 0.2f, 0.2f, 0.2f };
 
-uint8 color = COLOR_WHITE;
-
 int32 oldX = 0, oldY = 0;
 
 uint32 lastClickTime = 0;
 
-uint64 nextMoveTime = 0;
-
 Game* game = nullptr;
 
+RealTimeDriver* driver = nullptr;
+
+// 3D well mode (--3d), played instead of the 2D game and stepped against GLUT_ELAPSED_TIME
+Game3D* game3D = nullptr;
+int32 wellSize[3] = { DEFAULT_WELL_WIDTH, DEFAULT_WELL_DEPTH, DEFAULT_WELL_HEIGHT };
+uint32 lastWellStepTime = 0;
+
+BoardRenderer renderer;
+
+// Walls and next block box, fixed at compile time and uploaded on the first draw
+BoardRenderer panelRenderer;
+bool panelBuilt = false;
+
+const GLuint numTextures = 2;
+GLuint textureName[numTextures];
+
+// Textures and music are read on the loader thread, textures show a placeholder until uploaded
+AssetLoader assetLoader;
+uint32 textureAssets[numTextures];
+uint32 musicAsset = 0;
+std::vector<char> music;
+
 bool stopped = false;
 
 bool soundPaused = true;
 
+// Frames are only drawn when something changed, at most frameCap per second (0 = no cap)
+uint32 frameCap = DEFAULT_FRAME_CAP;
+uint32 lastFrameTime = 0;
+bool redrawPending = false;
+
+bool showProfiler = false;
+
+// Captured frames are read back asynchronously and written on the capture thread
+FrameCapture capture;
+CaptureFormat captureFormat = CAPTURE_BMP;
+bool captureAtStart = false;
+
+// Sessions recorded with --record are written on game over and on close, --replay plays one back
+ReplayRecorder recorder;
+const char* recordFilename = nullptr;
+ReplayPlayer replay;
+const char* replayFilename = nullptr;
+bool replayReported = false;
+
+// Attract mode ('a' or --bot): the bot plays one input every BOT_ACTION_DELAY ms and starts a new game after losing
+Bot bot;
+bool botPlaying = false;
+uint32 lastBotActionTime = 0;
+
+// --bot-time MS gives the bot that long per move for rollouts on every core
+uint32 botMoveTime = 0;
+ThreadPool* rolloutPool = nullptr;
+RolloutSearch* rollouts = nullptr;
+
 int main(int argc, char** argv) {
     
-    srand(unsigned int(time(nullptr)));
-
     // Inicializamos OpenGL
     glutInit(&argc, argv);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--fps") && i + 1 < argc)
+            frameCap = uint32(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--profile"))
+            showProfiler = true;
+        else if (!strcmp(argv[i], "--capture"))
+            captureAtStart = true;
+        else if (!strcmp(argv[i], "--capture-format") && i + 1 < argc)
+            captureFormat = strcmp(argv[++i], "y4m") ? CAPTURE_BMP : CAPTURE_Y4M;
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+            recordFilename = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replayFilename = argv[++i];
+        else if (!strcmp(argv[i], "--bot"))
+            botPlaying = true;
+        else if (!strcmp(argv[i], "--bot-time") && i + 1 < argc)
+            botMoveTime = uint32(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--3d"))
+            game3D = new Game3D();
+        else if (!strcmp(argv[i], "--well") && i + 1 < argc)
+            sscanf(argv[++i], "%dx%dx%d", &wellSize[0], &wellSize[1], &wellSize[2]);
+    }
+
+    // Replays and the bot only know the 2D game
+    if (game3D && (recordFilename || replayFilename || botPlaying || botMoveTime))
+    {
+        fprintf(stderr, "--record, --replay, --bot and --bot-time can't be used with --3d\n");
+        return(EXIT_FAILURE);
+    }
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
 
     // Inicializamos la Ventana
@@ -83,16 +211,55 @@ int main(int argc, char** argv) {
     glutMouseFunc(funMouse);
     glutMotionFunc(funMotion);
     glutPassiveMotionFunc(funMotionPassive);
-    glutIdleFunc(funIdle);
     glutMouseWheelFunc(funMouseWheel);
+    glutCloseFunc(funClose);
 
-    game = Game::CreateNewGame();
+    game = Game::CreateNewGame(DEFAULT_LEVEL, uint64(time(nullptr)));
     if (!game)
         return(EXIT_FAILURE);
-    
-    PlaySoundTetris(TEXT("../src/main.wav"), nullptr, SND_LOOP | SND_ASYNC);
-    game->StartGame();
 
+    driver = new RealTimeDriver(game);
+    
+    musicAsset = assetLoader.Request(ASSET_FILE, MUSIC_FILENAME);
+    Profiler::SetEnabled(showProfiler);
+    if (game3D)
+    {
+        if (!game3D->ResetGame(wellSize[0], wellSize[1], wellSize[2], DEFAULT_LEVEL, uint64(time(nullptr))))
+        {
+            fprintf(stderr, "Invalid well size %dx%dx%d\n", wellSize[0], wellSize[1], wellSize[2]);
+            return(EXIT_FAILURE);
+        }
+        game3D->StartGame();
+        lastWellStepTime = glutGet(GLUT_ELAPSED_TIME);
+    }
+    else if (replayFilename)
+    {
+        if (!replay.Load(replayFilename) || !replay.Start(game))
+        {
+            fprintf(stderr, "Unable to play replay: %s\n", replayFilename);
+            return(EXIT_FAILURE);
+        }
+        driver->SetReplay(&replay);
+    }
+    else
+    {
+        if (recordFilename)
+            game->SetRecorder(&recorder);
+        game->StartGame();
+    }
+    if (replayFilename)
+        botPlaying = false;
+    if (botMoveTime)
+    {
+        rolloutPool = new ThreadPool();
+        rollouts = new RolloutSearch(rolloutPool);
+        rollouts->SetBudget(botMoveTime * 1000);
+        bot.SetRolloutSearch(rollouts);
+        bot.SetTranspositionTable(&rollouts->GetTranspositionTable());
+    }
+    if (captureAtStart)
+        toggleCapture();
+    glutTimerFunc(0, funTimer, 0);
 
     // Bucle principal
     glutMainLoop();
@@ -116,6 +283,8 @@ void initFunc() {
     glEnable(GL_CULL_FACE);
     initLights();
     initTextures();
+    renderer.Init(textureName[0]);
+    panelRenderer.Init(textureName[0]);
     //initTextures();
     //glEnable(GL_CULL_FACE);
     //glCullFace(GL_BACK);
@@ -170,9 +339,6 @@ void initLights()
     }
 }
 
-const GLuint numTextures = 2;
-GLuint textureName[numTextures];
-
 void initTextures()
 {
     glEnable(GL_TEXTURE_2D);
@@ -184,9 +350,10 @@ void initTextures()
     {
         // Cargamos la textura
         glBindTexture(GL_TEXTURE_2D, textureName[i]);
-        RgbImage texture(filename[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture.GetNumCols(), texture.GetNumRows(), 0, GL_RGB, GL_UNSIGNED_BYTE, texture.ImageData());
-        gluBuild2DMipmaps(GL_TEXTURE_2D, 3, texture.GetNumCols(), texture.GetNumRows(), GL_RGB, GL_UNSIGNED_BYTE, texture.ImageData());
+        // A black texel leaves the GL_BLEND cubes with their plain color until the real one arrives
+        const GLubyte placeholder[4] = { 0, 0, 0, 0 };
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder);
+        textureAssets[i] = assetLoader.Request(GLEW_VERSION_1_4 && GLEW_ARB_texture_non_power_of_two ? ASSET_MAPPED_IMAGE : ASSET_IMAGE, filename[i]);
     
         // Configuramos la textura
         glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
@@ -201,6 +368,50 @@ void initTextures()
     }
 }
 
+void pollAssets()
+{
+    while (std::unique_ptr<Asset> asset = assetLoader.PollFinished())
+    {
+        if (!asset->isLoaded)
+            continue;
+
+        if (asset->id == musicAsset)
+        {
+            music.swap(asset->data);
+            if (soundPaused)
+                playMusic();
+            continue;
+        }
+
+        for (uint32 i = 0; i < numTextures; i++)
+        {
+            if (textureAssets[i] == asset->id)
+                uploadTexture(i, asset->image);
+        }
+        requestRedraw();
+    }
+}
+
+void uploadTexture(uint32 index, const RgbImage& image)
+{
+    glBindTexture(GL_TEXTURE_2D, textureName[index]);
+    if (GLEW_VERSION_1_4 && GLEW_ARB_texture_non_power_of_two)
+    {
+        // Mapped BGR rows go straight from the file, GL builds the mipmaps from level 0
+        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+        image.TexImage2D();
+    }
+    else
+        gluBuild2DMipmaps(GL_TEXTURE_2D, 3, image.GetNumCols(), image.GetNumRows(), GL_RGB, GL_UNSIGNED_BYTE, image.ImageData());
+}
+
+void playMusic()
+{
+    // Played from memory, nothing to do until the loader has read it
+    if (!music.empty())
+        PlaySoundTetris((LPCTSTR)music.data(), nullptr, SND_MEMORY | SND_LOOP | SND_ASYNC);
+}
+
 void funReshape(int w, int h) {
 
     // Configuramos el Viewport
@@ -214,6 +425,18 @@ void funReshape(int w, int h) {
 
 void funKeyboardUp(unsigned char key, int x, int y)
 {
+    if (game3D && handleWellKey(key))
+    {
+        checkGameEvents();
+        return;
+    }
+
+    if (driver->GetReplay() && handleReplayKey(key))
+    {
+        checkGameEvents();
+        return;
+    }
+
     switch (key)
     {
     case 'm':
@@ -221,7 +444,7 @@ void funKeyboardUp(unsigned char key, int x, int y)
         if (!soundPaused)
             PlaySoundTetris(nullptr, nullptr, 0);
         else
-            PlaySoundTetris(TEXT("../src/main.wav"), nullptr, SND_LOOP | SND_ASYNC);
+            playMusic();
         break;
     case 'r':
         cameraPos[0] = 2.0f;
@@ -232,18 +455,32 @@ void funKeyboardUp(unsigned char key, int x, int y)
         lookat[2] = -8.0f;
         break;
     case 'c':
-        game->ChangeBlock();
+        game->ApplyInput(INPUT_CHANGE_BLOCK);
         break;
     case ' ':
-        game->RotateActiveBlock();
+        game->ApplyInput(INPUT_ROTATE);
         break;
     case 13: // Enter
     case 27: // ESC
-        stopped = !stopped;
-        if (stopped)
-            game->PauseGame();
-        else
-            game->ResumeGame();
+        togglePause();
+        break;
+    case 'p':
+        showProfiler = !showProfiler;
+        Profiler::SetEnabled(showProfiler);
+        if (showProfiler)
+            Profiler::Clear();
+        requestRedraw();
+        break;
+    case 't':
+        if (Profiler::ExportChromeTrace(TRACE_FILENAME))
+            printf("Trace written to %s\n", TRACE_FILENAME);
+        break;
+    case 'v':
+        toggleCapture();
+        break;
+    case 'a':
+        botPlaying = !game3D && !driver->GetReplay() && !botPlaying;
+        lastBotActionTime = glutGet(GLUT_ELAPSED_TIME);
         break;
     case '+':
         game->SetLevel(game->GetLevel() + 1);
@@ -255,28 +492,49 @@ void funKeyboardUp(unsigned char key, int x, int y)
         break;
     }
 
+    if (key == 'r')
+        requestRedraw();
+
+    checkGameEvents();
     DEBUG_LOG("KEYBOARD: key: %c, x: %d, y: %d \n", key, x, y);
 }
 
 void funSpecial(int key, int x, int y)
 {
+    // The replay is the only source of input while it plays
+    if (driver->GetReplay())
+        return;
+
+    if (game3D)
+    {
+        // Up moves into the well, away from the camera
+        static const Input3DAction moves[] = { INPUT_3D_MOVE_LEFT, INPUT_3D_MOVE_FORWARD, INPUT_3D_MOVE_RIGHT, INPUT_3D_MOVE_BACK };
+        if (key >= GLUT_KEY_LEFT && key <= GLUT_KEY_DOWN)
+            game3D->ApplyInput(moves[key - GLUT_KEY_LEFT]);
+
+        checkGameEvents();
+        return;
+    }
+
     switch (key)
     {
     case GLUT_KEY_UP:
-        game->DropBlock();
+        game->ApplyInput(INPUT_HARD_DROP);
         break;
     case GLUT_KEY_DOWN:
-        game->IncreaseBlockSpeed();
+        game->ApplyInput(INPUT_SOFT_DROP);
         break;
     case GLUT_KEY_RIGHT:
-        game->MoveBlock(true);
+        game->ApplyInput(INPUT_MOVE_RIGHT);
         break;
     case GLUT_KEY_LEFT:
-        game->MoveBlock(false);
+        game->ApplyInput(INPUT_MOVE_LEFT);
         break;
     default:
         break;
     }
+
+    checkGameEvents();
     DEBUG_LOG("KEYBOARD SPECIAL: key: %d, x: %d, y: %d \n", key, x, y);
 }
 
@@ -288,7 +546,7 @@ void funMouse(int key, int state, int x, int y)
     if (state == GLUT_UP)
     {   
         if ((glutGet(GLUT_ELAPSED_TIME) - lastClickTime) < DOUBLE_CLICK_TIME)
-            stopped = !stopped;
+            togglePause();
 
         lastClickTime = glutGet(GLUT_ELAPSED_TIME);
     }
@@ -313,6 +571,7 @@ void funMotion(int x, int y)
 
         oldX = x;
         oldY = y;
+        requestRedraw();
     }
 
     DEBUG_LOG("MOTION: x: %d, y: %d \n", x, y);
@@ -324,6 +583,7 @@ void funMotion(int x, int y)
 void funMouseWheel(int wheel, int direction, int x, int y)
 {
     cameraPos[2] = std::min<GLfloat>(MIN_ZOOM, std::max<GLfloat>(MAX_ZOOM, cameraPos[2] - direction * 0.3f));
+    requestRedraw();
     DEBUG_LOG("MOUSEWHEEL: wheel: %d, direction: %d, x: %d, y: %d, positionZ: %f \n", wheel, direction, x, y, cameraPos[2]);
 }
 
@@ -332,19 +592,207 @@ void funDisplay()
     drawFrame();
 }
 
-void funIdle()
+void funTimer(int value)
+{
+    if (game3D)
+        stepWell();
+    else
+    {
+        driver->Update();
+        if (botPlaying)
+            stepBot();
+    }
+    checkGameEvents();
+    pollAssets();
+
+    // The overlay changes with time even when the game does not, a capture needs a steady frame rate
+    if (redrawPending || showProfiler || capture.IsCapturing())
+        requestRedraw();
+
+    glutTimerFunc(getTimerDelay(), funTimer, 0);
+}
+
+void funClose()
+{
+    // The read back buffers need the context, which is gone by the time globals are destroyed
+    capture.Stop();
+    saveRecording();
+}
+
+void requestRedraw()
 {
+    redrawPending = true;
+
+    uint32 now = glutGet(GLUT_ELAPSED_TIME);
+    uint32 fps = capture.IsCapturing() ? getCaptureFps() : frameCap;
+    if (!fps || now - lastFrameTime >= 1000 / fps)
+    {
+        redrawPending = false;
+        glutPostRedisplay();
+    }
+}
+
+void checkGameEvents()
+{
+    uint32 events = game3D ? game3D->ConsumeEvents() : game->ConsumeEvents();
+    if (events)
+        requestRedraw();
+
+    if ((events & EVENT_STATE_CHANGED) && game->IsGameOver())
+        saveRecording();
+
+    if (driver->GetReplay() && !replayReported && (replay.IsFinished() || replay.IsDesynced()))
+    {
+        replayReported = true;
+        if (replay.IsVerified())
+            printf("Replay finished, %u points\n", game->GetPoints());
+        else
+            printf("Replay out of sync at tick %llu\n", (unsigned long long)replay.GetDesyncTick());
+    }
+}
+
+uint32 getTimerDelay()
+{
+    // Wake up for assets still loading, a capped frame that is still waiting or the next gravity step
+    uint32 delay = assetLoader.GetPendingCount() ? ASSET_POLL_DELAY : IDLE_TIMER_DELAY;
+    uint32 fps = capture.IsCapturing() ? getCaptureFps() : frameCap;
+    if (redrawPending || capture.IsCapturing())
+    {
+        uint32 elapsed = glutGet(GLUT_ELAPSED_TIME) - lastFrameTime;
+        delay = std::min<uint32>(delay, elapsed < 1000 / fps ? 1000 / fps - elapsed : 0);
+    }
+
+    if (game3D)
+    {
+        if (!stopped && !game3D->IsGameOver())
+            delay = uint32(std::min<uint64>(delay, game3D->GetNextDropTick() - game3D->GetTick()));
+    }
+    else if (!stopped && !game->IsGameOver())
+        delay = std::min<uint32>(delay, uint32((driver->GetMicrosecondsToNextDrop() + 999) / 1000));
+
+    if (botPlaying && !stopped)
+    {
+        uint32 elapsed = glutGet(GLUT_ELAPSED_TIME) - lastBotActionTime;
+        delay = std::min<uint32>(delay, elapsed < BOT_ACTION_DELAY ? BOT_ACTION_DELAY - elapsed : 0);
+    }
+
+    return delay;
+}
+
+uint32 getCaptureFps()
+{
+    // Videos are written at a fixed rate, uncapped games record at the default cap
+    return frameCap ? frameCap : DEFAULT_FRAME_CAP;
+}
+
+bool handleWellKey(unsigned char key)
+{
+    switch (key)
+    {
+    case 'q':
+        game3D->ApplyInput(INPUT_3D_ROTATE_X);
+        return true;
+    case 'w':
+        game3D->ApplyInput(INPUT_3D_ROTATE_Y);
+        return true;
+    case 'e':
+        game3D->ApplyInput(INPUT_3D_ROTATE_Z);
+        return true;
+    case 's':
+        game3D->ApplyInput(INPUT_3D_SOFT_DROP);
+        return true;
+    case ' ':
+        game3D->ApplyInput(INPUT_3D_HARD_DROP);
+        return true;
+    case 'c':
+    case '+':
+    case '-':
+        return true;
+    default:
+        return false;
+    }
+}
+
+void stepWell()
+{
+    // One tick per millisecond, the time spent paused is dropped
+    uint32 now = glutGet(GLUT_ELAPSED_TIME);
     if (!stopped)
-        game->Update();
+        game3D->Step((now - lastWellStepTime) * TICKS_PER_SECOND / 1000);
+    lastWellStepTime = now;
+}
 
-    drawFrame();
+void stepBot()
+{
+    uint32 now = glutGet(GLUT_ELAPSED_TIME);
+    if (stopped || now - lastBotActionTime < BOT_ACTION_DELAY)
+        return;
+
+    lastBotActionTime = now;
+    if (game->IsGameOver())
+    {
+        game->ResetGame(DEFAULT_LEVEL, uint64(time(nullptr)));
+        game->StartGame();
+        return;
+    }
+
+    game->ApplyInput(bot.GetNextAction(*game));
+}
+
+bool handleReplayKey(unsigned char key)
+{
+    switch (key)
+    {
+    case 'c':
+    case ' ':
+        return true;
+    case '+':
+        driver->SetSpeed(std::min(driver->GetSpeed() * 2, uint32(MAX_REPLAY_SPEED)));
+        break;
+    case '-':
+        driver->SetSpeed(driver->GetSpeed() / 2);
+        break;
+    default:
+        return false;
+    }
+
+    printf("Replay speed x%u\n", driver->GetSpeed());
+    return true;
+}
+
+void saveRecording()
+{
+    if (!recordFilename)
+        return;
+
+    // Closes the recording, a game still running ends where it was left
+    recorder.Finish(*game);
+    if (recorder.Save(recordFilename))
+        printf("Replay written to %s\n", recordFilename);
+}
+
+void toggleCapture()
+{
+    if (capture.IsCapturing())
+    {
+        capture.Stop();
+        printf("Capture stopped: %u frames written, %u dropped\n", capture.GetCapturedFrames(), capture.GetDroppedFrames());
+        return;
+    }
+
+    const char* path = captureFormat == CAPTURE_Y4M ? CAPTURE_Y4M_FILENAME : CAPTURE_BMP_PREFIX;
+    if (capture.Start(path, captureFormat, glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT), getCaptureFps()))
+        printf("Capturing to %s\n", path);
 }
 
 void drawFrame()
 {
+    PROFILE_SCOPE("drawFrame");
+
     // Borramos el buffer de color y el de profundidad
     glClearColor(SCREEN_COLOR);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    lastFrameTime = glutGet(GLUT_ELAPSED_TIME);
 
     // Posicionamos la cmara (V)
     glMatrixMode(GL_MODELVIEW);
@@ -356,8 +804,13 @@ void drawFrame()
                      up[0],        up[1],        up[2]);
     
     glScaled(0.5f, 0.5f, 0.5f);
-    drawPanel();
-    drawBlocks();
+    if (game3D)
+        drawWell();
+    else
+    {
+        drawPanel();
+        drawBlocks();
+    }
     glScaled(1.0f, 1.0f, 1.0f);
 
     if (stopped)
@@ -365,6 +818,10 @@ void drawFrame()
 
     drawPoints();
 
+    if (showProfiler)
+        drawProfiler();
+
+    capture.CaptureFrame();
     //DEBUG_LOG("points = %u : %s", game->GetPoints(), std::to_string(game->GetPoints()));
     
     // Intercambiamos los buffers
@@ -373,204 +830,68 @@ void drawFrame()
 
 void drawBlocks()
 {
-    // Draw the active falling block
-    if (game->GetActiveBlock())
-        drawBlock(game->GetActiveBlock());
-
-    // Draw the next block
-    if (game->GetNextBlock())
-        drawBlock(game->GetNextBlock());
-
-    // Draw other subBlocks
-    for (SubBlock* sub : game->GetSubBlockList())
-        drawSubBlock(sub);
+    // Active block, next block and the locked subBlocks in one batch
+    renderer.Begin();
+    renderer.AddGame(game);
+    renderer.Flush();
 }
 
-void drawBlock(Block* block)
+void drawWell()
 {
-    if (!block)
-        return;
-
-    if (block->GetType() >= MAX_BLOCK_TYPE)
-    {
-        DEBUG_LOG("Block type not supported: type (%d)", block->GetType());
-        exit(1);
-    }
-    
-    color = block->GetColor();
-    Block::SubBlockVector subBlocks = block->GetSubBlocks();
-
-    float correction[2] = {0.0f, 0.0f};
-    
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, textureName[0]);
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    const Well3D& well = game3D->GetWell();
 
+    // Tilted towards the camera around its floor so the layers can be seen from above,
+    // and shrunk to the height of the 2D board when it is taller
+    GLfloat centerX = GLfloat(well.GetWidth() - 1) * 0.5f;
+    GLfloat centerZ = -GLfloat(well.GetDepth() - 1) * 0.5f;
+    GLfloat scale = std::min(1.0f, GLfloat(MAX_HEIGHT) / GLfloat(well.GetHeight()));
     glPushMatrix();
-    {
-        glTranslatef(block->GetPositionX() + correction[0], block->GetPositionY() + correction[1], block->GetPositionZ());
+    glTranslatef(centerX, 0.0f, centerZ);
+    glRotatef(WELL_TILT, 1.0f, 0.0f, 0.0f);
+    glScalef(scale, scale, scale);
+    glTranslatef(-centerX, 0.0f, -centerZ);
 
-        // Cube should not rotate
-        //if (block->GetType() != TYPE_CUBE)
-        //    glRotatef(block->GetRotation(), 0.0f, 0.0f, 1.0f);
+    renderer.Begin();
+    renderer.AddWell(game3D);
+    renderer.Flush();
+    drawWellEdges(well);
 
-        if (correction[0] != 0.0f || correction[1] != 0.0f)
-            glTranslatef(-correction[0], -correction[1], 0.0f);
-
-        for (SubBlock* sub : subBlocks)
-        {
-            glPushMatrix();
-            glTranslatef(sub->GetPositionX(), sub->GetPositionY(), sub->GetPositionZ());
-            drawBasicBlock();
-            glPopMatrix();
-        }
-    }
     glPopMatrix();
-    glDisable(GL_TEXTURE_2D);
 }
 
-void drawSubBlock(SubBlock* sub)
+void drawWellEdges(const Well3D& well)
 {
-    color = sub->GetColor();
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, textureName[0]);
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glPushMatrix();
-    glTranslatef(sub->GetPositionX(), sub->GetPositionY(), sub->GetPositionZ());
-    drawBasicBlock();
-    glPopMatrix();
-    glDisable(GL_TEXTURE_2D);
-}
-
-void selectColor(uint8 color)
-{
-    switch(color)
-    {
-    case COLOR_WHITE:
-    {
-        GLfloat Kad[] = {1.0, 1.0, 1.0, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(1.0, 1.0, 1.0);
-        break;
-    }
-    case COLOR_BLACK:
-    {
-        GLfloat Kad[] = {0.0, 0.0, 0.0, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(0.0, 0.0, 0.0);
-        break;
-    }
-    case COLOR_RED:
-    {
-        GLfloat Kad[] = {0.863f, 0.078f, 0.235f, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(0.863f, 0.078f, 0.235f);
-        break;
-    }
-    case COLOR_BLUE:
-    {
-        GLfloat Kad[] = {0.118f, 0.565f, 1.000f, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(0.118f, 0.565f, 1.000f);
-        break;
-    }
-    case COLOR_GREEN:
-    {
-        GLfloat Kad[] = {0.235f, 0.702f, 0.443f, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(0.235f, 0.702f, 0.443f);
-        break;
-    }
-    case COLOR_YELLOW:
+    GLfloat right = GLfloat(well.GetWidth()) - 0.5f;
+    GLfloat top = GLfloat(well.GetHeight()) - 0.5f;
+    GLfloat back = 0.5f - GLfloat(well.GetDepth());
+
+    glDisable(GL_LIGHTING);
+    glColor3f(0.6f, 0.6f, 0.6f);
+    glBegin(GL_LINES);
+    // Layer lines on the back and side walls
+    for (int32 y = 0; y <= well.GetHeight(); y++)
     {
-        GLfloat Kad[] = {1.0, 1.0, 0.0, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(1.0, 1.0, 0.0);
-        break;
+        GLfloat height = GLfloat(y) - 0.5f;
+        glVertex3f(-0.5f, height, 0.5f);
+        glVertex3f(-0.5f, height, back);
+        glVertex3f(-0.5f, height, back);
+        glVertex3f(right, height, back);
+        glVertex3f(right, height, back);
+        glVertex3f(right, height, 0.5f);
     }
-    case COLOR_PINK:
-    {
-        GLfloat Kad[] = {1.0, 0.0, 0.5, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(1.0, 0.0, 0.5);
-        break;
-    }
-    case COLOR_ORANGE:
-    {
-        GLfloat Kad[] = {1.0, 0.5, 0.0, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(1.0, 0.5, 0.0);
-        break;
-    }
-    case COLOR_GRAY:
-    {
-        GLfloat Kad[] = {0.653f, 0.653f, 0.653f, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(0.753f, 0.753f, 0.753f);
-        break;
-    }
-    case COLOR_CYAN:
-    {
-        GLfloat Kad[] = {0.902f, 0.902f, 0.980f, 1.0};
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, Kad);
-        glColor3f(0.902f, 0.902f, 0.980f);
-        break;
-    }
-    default:
-        break;
-    }
-}
-
-void drawCube(GLfloat size)
-{
-    GLfloat dimension = size / 2.0f;
 
-   // draw a cube (6 quadrilaterals)
-    glBegin(GL_QUADS);				// start drawing the cube.
- 
-	    // Front Face
-	    glTexCoord2f(0.0f, 0.0f); glVertex3f(-dimension, -dimension,  dimension);	// Bottom Left Of The Texture and Quad
-	    glTexCoord2f(1.0f, 0.0f); glVertex3f( dimension, -dimension,  dimension);	// Bottom Right Of The Texture and Quad
-	    glTexCoord2f(1.0f, 1.0f); glVertex3f( dimension,  dimension,  dimension);	// Top Right Of The Texture and Quad
-	    glTexCoord2f(0.0f, 1.0f); glVertex3f(-dimension,  dimension,  dimension);	// Top Left Of The Texture and Quad
- 
-	    // Back Face
-	    glTexCoord2f(1.0f, 0.0f); glVertex3f(-dimension, -dimension, -dimension);	// Bottom Right Of The Texture and Quad
-	    glTexCoord2f(1.0f, 1.0f); glVertex3f(-dimension,  dimension, -dimension);	// Top Right Of The Texture and Quad
-	    glTexCoord2f(0.0f, 1.0f); glVertex3f( dimension,  dimension, -dimension);	// Top Left Of The Texture and Quad
-	    glTexCoord2f(0.0f, 0.0f); glVertex3f( dimension, -dimension, -dimension);	// Bottom Left Of The Texture and Quad
- 
-	    // Top Face
-	    glTexCoord2f(0.0f, 1.0f); glVertex3f(-dimension,  dimension, -dimension);	// Top Left Of The Texture and Quad
-	    glTexCoord2f(0.0f, 0.0f); glVertex3f(-dimension,  dimension,  dimension);	// Bottom Left Of The Texture and Quad
-	    glTexCoord2f(1.0f, 0.0f); glVertex3f( dimension,  dimension,  dimension);	// Bottom Right Of The Texture and Quad
-	    glTexCoord2f(1.0f, 1.0f); glVertex3f( dimension,  dimension, -dimension);	// Top Right Of The Texture and Quad
- 
-	    // Bottom Face
-	    glTexCoord2f(1.0f, 1.0f); glVertex3f(-dimension, -dimension, -dimension);	// Top Right Of The Texture and Quad
-	    glTexCoord2f(0.0f, 1.0f); glVertex3f( dimension, -dimension, -dimension);	// Top Left Of The Texture and Quad
-	    glTexCoord2f(0.0f, 0.0f); glVertex3f( dimension, -dimension,  dimension);	// Bottom Left Of The Texture and Quad
-	    glTexCoord2f(1.0f, 0.0f); glVertex3f(-dimension, -dimension,  dimension);	// Bottom Right Of The Texture and Quad
- 
-	    // Right face
-	    glTexCoord2f(1.0f, 0.0f); glVertex3f( dimension, -dimension, -dimension);	// Bottom Right Of The Texture and Quad
-	    glTexCoord2f(1.0f, 1.0f); glVertex3f( dimension,  dimension, -dimension);	// Top Right Of The Texture and Quad
-	    glTexCoord2f(0.0f, 1.0f); glVertex3f( dimension,  dimension,  dimension);	// Top Left Of The Texture and Quad
-	    glTexCoord2f(0.0f, 0.0f); glVertex3f( dimension, -dimension,  dimension);	// Bottom Left Of The Texture and Quad
- 
-	    // Left Face
-	    glTexCoord2f(0.0f, 0.0f); glVertex3f(-dimension, -dimension, -dimension);	// Bottom Left Of The Texture and Quad
-	    glTexCoord2f(1.0f, 0.0f); glVertex3f(-dimension, -dimension,  dimension);	// Bottom Right Of The Texture and Quad
-	    glTexCoord2f(1.0f, 1.0f); glVertex3f(-dimension,  dimension,  dimension);	// Top Right Of The Texture and Quad
-	    glTexCoord2f(0.0f, 1.0f); glVertex3f(-dimension,  dimension, -dimension);	// Top Left Of The Texture and Quad
- 
-    glEnd();					// Done Drawing The Cube
- 
+    glVertex3f(-0.5f, -0.5f, 0.5f);
+    glVertex3f(-0.5f, top, 0.5f);
+    glVertex3f(right, -0.5f, 0.5f);
+    glVertex3f(right, top, 0.5f);
+    glVertex3f(-0.5f, -0.5f, back);
+    glVertex3f(-0.5f, top, back);
+    glVertex3f(right, -0.5f, back);
+    glVertex3f(right, top, back);
+    glVertex3f(-0.5f, top, 0.5f);
+    glVertex3f(right, top, 0.5f);
+    glEnd();
+    glEnable(GL_LIGHTING);
 }
 
 void drawPause()
@@ -606,114 +927,41 @@ void drawPlane(GLfloat size)
     glEnd();
 }
 
-void drawBasicBlock(bool withBorder /*=true*/)
+void drawPanel()
 {
-    selectColor(color);
-    
-    glEnable(GL_TEXTURE_2D);
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    drawCube(1.0f);
-
-    glDisable(GL_TEXTURE_2D);
-    //glutSolidCube(1.0f);
+    if (!panelBuilt)
+        buildPanel();
 
-
-    /*if (withBorder)
-    {
-        glLineWidth(2.0);
-        selectColor(COLOR_BLACK);
-        glutWireCube(1.0f);
-    }*/
+    panelRenderer.Draw();
 }
 
-void drawPanel()
+void buildPanel()
 {
-    uint8 oldColor = color;
-    color = COLOR_GRAY;
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, textureName[0]);
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glPushMatrix();
-    {
-        glTranslatef(0.0, -1.0, 0.0);
-        for (uint8 i = 0; i < MAX_WIDTH; i++)
-        {
-            drawBasicBlock();
-            glTranslatef(1.0, 0.0, 0.0);
-        }
-    }
-    glPopMatrix();
+    panelRenderer.Begin();
 
-    glPushMatrix();
-    {
-        glTranslatef(-1.0, -1.0, 0.0);
-        for (uint8 i = 0; i < MAX_HEIGHT; i++)
-        {
-            drawBasicBlock();
-            glTranslatef(0.0, 1.0, 0.0);
-        }
-    }
-    glPopMatrix();
+    for (uint8 i = 0; i < MAX_WIDTH; i++)
+        panelRenderer.AddCube(float(i), -1.0f, 0.0f, COLOR_GRAY);
 
-    glPushMatrix();
+    for (uint8 i = 0; i < MAX_HEIGHT; i++)
     {
-        glTranslatef(MAX_WIDTH, -1.0, 0.0);
-        for (uint8 i = 0; i < MAX_HEIGHT; i++)
-        {
-            drawBasicBlock();
-            glTranslatef(0.0, 1.0, 0.0);
-        }
+        panelRenderer.AddCube(-1.0f, float(i) - 1.0f, 0.0f, COLOR_GRAY);
+        panelRenderer.AddCube(float(MAX_WIDTH), float(i) - 1.0f, 0.0f, COLOR_GRAY);
     }
-    glPopMatrix();
 
-    glPushMatrix();
-    {
-        glTranslatef(DISPLAY_NEXT_BLOCK_X, DISPLAY_NEXT_BLOCK_Y, 0.0);
-        for (uint8 i = 0; i < DISPLAY_NEXT_BLOCK_HEIGHT; i++)
-        {
-            drawBasicBlock();
-            glTranslatef(0.0, 1.0, 0.0);
-        }
-    }
-    glPopMatrix();
+    for (uint8 i = 0; i < DISPLAY_NEXT_BLOCK_HEIGHT; i++)
+        panelRenderer.AddCube(DISPLAY_NEXT_BLOCK_X, DISPLAY_NEXT_BLOCK_Y + i, 0.0f, COLOR_GRAY);
 
-    glPushMatrix();
-    {
-        glTranslatef(DISPLAY_NEXT_BLOCK_X + DISPLAY_NEXT_BLOCK_WITDH, DISPLAY_NEXT_BLOCK_Y, 0.0);
-        for (uint8 i = 0; i < DISPLAY_NEXT_BLOCK_HEIGHT + 1; i++)
-        {
-            drawBasicBlock();
-            glTranslatef(0.0, 1.0, 0.0);
-        }
-    }
-    glPopMatrix();
+    for (uint8 i = 0; i < DISPLAY_NEXT_BLOCK_HEIGHT + 1; i++)
+        panelRenderer.AddCube(DISPLAY_NEXT_BLOCK_X + DISPLAY_NEXT_BLOCK_WITDH, DISPLAY_NEXT_BLOCK_Y + i, 0.0f, COLOR_GRAY);
 
-    glPushMatrix();
+    for (uint8 i = 0; i < DISPLAY_NEXT_BLOCK_WITDH; i++)
     {
-        glTranslatef(DISPLAY_NEXT_BLOCK_X, DISPLAY_NEXT_BLOCK_Y, 0.0);
-        for (uint8 i = 0; i < DISPLAY_NEXT_BLOCK_WITDH; i++)
-        {
-            drawBasicBlock();
-            glTranslatef(1.0, 0.0, 0.0);
-        }
-    }
-    glPopMatrix();
-    glPushMatrix();
-    {
-        glTranslatef(DISPLAY_NEXT_BLOCK_X, DISPLAY_NEXT_BLOCK_Y + DISPLAY_NEXT_BLOCK_HEIGHT, 0.0);
-        for (uint8 i = 0; i < DISPLAY_NEXT_BLOCK_WITDH; i++)
-        {
-            drawBasicBlock();
-            glTranslatef(1.0, 0.0, 0.0);
-        }
+        panelRenderer.AddCube(DISPLAY_NEXT_BLOCK_X + i, DISPLAY_NEXT_BLOCK_Y, 0.0f, COLOR_GRAY);
+        panelRenderer.AddCube(DISPLAY_NEXT_BLOCK_X + i, DISPLAY_NEXT_BLOCK_Y + DISPLAY_NEXT_BLOCK_HEIGHT, 0.0f, COLOR_GRAY);
     }
-    glPopMatrix();
-    color = oldColor;
-    glDisable(GL_TEXTURE_2D);
+
+    panelRenderer.Upload();
+    panelBuilt = true;
 }
 
 void renderText(float x, float y, void *font, const unsigned char* string)
@@ -725,7 +973,44 @@ void renderText(float x, float y, void *font, const unsigned char* string)
 void drawPoints()
 {
     unsigned char points[BUFFER_SIZE];
-    std::string pointsString = " Puntuacion: " + std::to_string(game->GetPoints()) + "\n Nivel: " + std::to_string(game->GetLevel()) + "\n Velocidad: " + std::to_string(game->GetSpeed());
-    strcpy_s((char*)points, BUFFER_SIZE, pointsString.c_str());
+    uint32 score = game3D ? game3D->GetPoints() : game->GetPoints();
+    uint32 level = game3D ? game3D->GetLevel() : game->GetLevel();
+    double speed = game3D ? game3D->GetSpeed() : game->GetSpeed();
+    std::string pointsString = " Puntuacion: " + std::to_string(score) + "\n Nivel: " + std::to_string(level) + "\n Velocidad: " + std::to_string(speed);
+    snprintf((char*)points, BUFFER_SIZE, "%s", pointsString.c_str());
     renderText(POINTS_X, POINTS_Y, GLUT_BITMAP_9_BY_15, points);
 }
+
+void drawProfiler()
+{
+    std::vector<ProfileStat> stats;
+    Profiler::Summarize(stats, PROFILE_WINDOW);
+
+    std::string text = "Perfil (ms, ultimo segundo)  media / max / n";
+    for (const ProfileStat& stat : stats)
+    {
+        char line[BUFFER_SIZE];
+        snprintf(line, BUFFER_SIZE, "\n%s: %.3f / %.3f / %u", stat.name, double(stat.total) / stat.count / 1e6, double(stat.max) / 1e6, stat.count);
+        text += line;
+    }
+
+    renderText(POINTS_X, PROFILE_Y, GLUT_BITMAP_9_BY_15, (const unsigned char*)text.c_str());
+}
+
+void togglePause()
+{
+    stopped = !stopped;
+    if (game3D)
+    {
+        if (stopped)
+            game3D->PauseGame();
+        else
+            game3D->ResumeGame();
+    }
+    else if (stopped)
+        driver->Pause();
+    else
+        driver->Resume();
+
+    checkGameEvents();
+}
@@ -0,0 +1,298 @@
+// Runs many independent headless games in parallel and reports aggregate statistics.
+// Usage: TetrisBatch [--games N] [--threads N] [--seed N] [--level N] [--policy random|drop|bot|rollout]
+//                    [--generator norepeat|bag] [--max-pieces N] [--csv file] [--record prefix] [--move-time MS]
+// The rollout policy plays the games one after another and spreads the rollouts of each move over the threads.
+
+#include "Bot.h"
+#include "Game.h"
+#include "Random.h"
+#include "Replay.h"
+#include "RolloutSearch.h"
+#include "TranspositionTable.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstring>
+
+// Ticks between two decisions of the random policy
+#define RANDOM_POLICY_INTERVAL      50
+
+enum PolicyType : uint8
+{
+    POLICY_RANDOM = 0,      // Random move, rotate or soft drop every few ticks, gravity does the rest
+    POLICY_DROP,            // Random rotation and column for each block, then hard drop
+    POLICY_BOT,             // Best placement found by the bot, looking at the next block
+    POLICY_ROLLOUT,         // Bot with random rollouts of the blocks after the next one
+    MAX_POLICY_TYPE
+};
+
+struct BatchOptions
+{
+    uint32 games        = 1000;
+    uint32 threads      = 0;
+    uint64 seed         = DEFAULT_SEED;
+    uint32 level        = DEFAULT_LEVEL;
+    uint32 maxPieces    = 10000;
+    PolicyType policy   = POLICY_DROP;
+    GeneratorPolicy generator = GENERATOR_NO_REPEAT;
+    const char* csvFile = nullptr;
+    const char* recordPrefix = nullptr;
+    uint32 moveTime     = ROLLOUT_DEFAULT_BUDGET / 1000;
+};
+
+struct GameResult
+{
+    uint64 seed;
+    uint32 lines;
+    uint32 points;
+    uint32 level;
+    uint32 pieces;
+    uint64 ticks;
+};
+
+void PlayRandomPolicy(Game* game, Random& random, uint32 maxPieces)
+{
+    while (!game->IsGameOver() && game->GetPiecesPlaced() < maxPieces)
+    {
+        game->ApplyInput(InputAction(INPUT_MOVE_LEFT + random.Next(INPUT_SOFT_DROP - INPUT_MOVE_LEFT + 1)));
+        game->Step(RANDOM_POLICY_INTERVAL);
+    }
+}
+
+void PlayDropPolicy(Game* game, Random& random, uint32 maxPieces)
+{
+    while (!game->IsGameOver() && game->GetPiecesPlaced() < maxPieces)
+    {
+        Block* block = game->GetActiveBlock();
+
+        uint32 rotations = random.Next(NUM_ROTATIONS);
+        for (uint32 i = 0; i < rotations; i++)
+            game->ApplyInput(INPUT_ROTATE);
+
+        int32 column = int32(random.Next(BOARD_WIDTH));
+        while (block->GetPositionX() != column)
+        {
+            int32 oldX = block->GetPositionX();
+            game->ApplyInput(column > oldX ? INPUT_MOVE_RIGHT : INPUT_MOVE_LEFT);
+            if (block->GetPositionX() == oldX)
+                break;
+        }
+
+        game->ApplyInput(INPUT_HARD_DROP);
+    }
+}
+
+void PlayBotPolicy(Game* game, uint32 maxPieces, RolloutSearch* rollouts, TranspositionTable* table)
+{
+    Bot bot;
+    bot.SetRolloutSearch(rollouts);
+    bot.SetTranspositionTable(table);
+    while (!game->IsGameOver() && game->GetPiecesPlaced() < maxPieces)
+    {
+        InputAction action = bot.GetNextAction(*game);
+        if (action == INPUT_NONE)
+            break;
+
+        game->ApplyInput(action);
+    }
+}
+
+GameResult PlayGame(const BatchOptions& options, uint32 index, TranspositionTable* table, RolloutSearch* rollouts = nullptr)
+{
+    GameResult result;
+    result.seed = options.seed + index;
+
+    Game game;
+    ReplayRecorder recorder;
+    if (options.recordPrefix)
+        game.SetRecorder(&recorder);
+
+    game.ResetGame(options.level, result.seed, options.generator);
+    game.StartGame();
+
+    // The policy has its own stream so it doesn't disturb the pieces of the game
+    Random random(result.seed ^ 0xB47C4ULL);
+    switch (options.policy)
+    {
+    case POLICY_RANDOM:
+        PlayRandomPolicy(&game, random, options.maxPieces);
+        break;
+    case POLICY_BOT:
+    case POLICY_ROLLOUT:
+        PlayBotPolicy(&game, options.maxPieces, rollouts, table);
+        break;
+    case POLICY_DROP:
+    default:
+        PlayDropPolicy(&game, random, options.maxPieces);
+        break;
+    }
+
+    result.lines = game.GetLinesCompleted();
+    result.points = game.GetPoints();
+    result.level = game.GetLevel();
+    result.pieces = game.GetPiecesPlaced();
+    result.ticks = game.GetTick();
+
+    if (options.recordPrefix)
+    {
+        char filename[FILENAME_MAX];
+        snprintf(filename, sizeof(filename), "%s%06u.replay", options.recordPrefix, index);
+        recorder.Finish(game);
+        recorder.Save(filename);
+    }
+    return result;
+}
+
+bool ParseOptions(int argc, char** argv, BatchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+
+        if (!strcmp(arg, "--games"))
+            options.games = uint32(strtoul(value, nullptr, 10));
+        else if (!strcmp(arg, "--threads"))
+            options.threads = uint32(strtoul(value, nullptr, 10));
+        else if (!strcmp(arg, "--seed"))
+            options.seed = strtoull(value, nullptr, 10);
+        else if (!strcmp(arg, "--level"))
+            options.level = std::max(1u, uint32(strtoul(value, nullptr, 10)));
+        else if (!strcmp(arg, "--max-pieces"))
+            options.maxPieces = uint32(strtoul(value, nullptr, 10));
+        else if (!strcmp(arg, "--csv"))
+            options.csvFile = value;
+        else if (!strcmp(arg, "--record"))
+            options.recordPrefix = value;
+        else if (!strcmp(arg, "--move-time"))
+            options.moveTime = uint32(strtoul(value, nullptr, 10));
+        else if (!strcmp(arg, "--policy") && !strcmp(value, "random"))
+            options.policy = POLICY_RANDOM;
+        else if (!strcmp(arg, "--policy") && !strcmp(value, "drop"))
+            options.policy = POLICY_DROP;
+        else if (!strcmp(arg, "--policy") && !strcmp(value, "bot"))
+            options.policy = POLICY_BOT;
+        else if (!strcmp(arg, "--policy") && !strcmp(value, "rollout"))
+            options.policy = POLICY_ROLLOUT;
+        else if (!strcmp(arg, "--generator") && !strcmp(value, "norepeat"))
+            options.generator = GENERATOR_NO_REPEAT;
+        else if (!strcmp(arg, "--generator") && !strcmp(value, "bag"))
+            options.generator = GENERATOR_BAG;
+        else
+        {
+            fprintf(stderr, "Unknown option %s %s\n", arg, value);
+            return false;
+        }
+        i++;
+    }
+
+    return true;
+}
+
+bool WriteCsv(const char* filename, const std::vector<GameResult>& results)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open file: %s\n", filename);
+        return false;
+    }
+
+    fprintf(file, "seed,lines,points,level,pieces,ticks\n");
+    for (const GameResult& result : results)
+        fprintf(file, "%llu,%u,%u,%u,%u,%llu\n", (unsigned long long)result.seed, result.lines, result.points, result.level, result.pieces, (unsigned long long)result.ticks);
+
+    fclose(file);
+    return true;
+}
+
+void PrintStat(const char* name, double total, double max, uint32 games)
+{
+    printf("%-18s mean %12.2f   max %12.0f   total %14.0f\n", name, total / games, max, total);
+}
+
+int main(int argc, char** argv)
+{
+    BatchOptions options;
+    if (!ParseOptions(argc, argv, options) || !options.games)
+        return EXIT_FAILURE;
+
+    std::vector<GameResult> results(options.games);
+
+    uint64 rollouts = 0, moves = 0, probes = 0;
+    double hitRate = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.threads);
+        options.threads = pool.GetThreadCount();
+
+        if (options.policy == POLICY_ROLLOUT)
+        {
+            // The rollouts of each move already use every worker
+            RolloutSearch search(&pool);
+            search.SetBudget(options.moveTime * 1000);
+            search.SetSeed(options.seed);
+            TranspositionTable& table = search.GetTranspositionTable();
+            for (uint32 i = 0; i < options.games; i++)
+                results[i] = PlayGame(options, i, &table, &search);
+
+            rollouts = search.GetRolloutCount();
+            moves = search.GetMoveCount();
+            probes = table.GetProbeCount();
+            hitRate = table.GetHitRate();
+        }
+        else
+        {
+            // One task per game, each task writes only its own slot. The bots share their table
+            TranspositionTable table;
+            for (uint32 i = 0; i < options.games; i++)
+                pool.Submit([&options, &results, &table, i]() { results[i] = PlayGame(options, i, &table); });
+
+            pool.Wait();
+            probes = table.GetProbeCount();
+            hitRate = table.GetHitRate();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double lines = 0.0, points = 0.0, levels = 0.0, pieces = 0.0, ticks = 0.0;
+    uint32 maxLines = 0, maxPoints = 0, maxLevel = 0, maxPieces = 0;
+    uint64 maxTicks = 0;
+    for (const GameResult& result : results)
+    {
+        lines += result.lines;
+        points += result.points;
+        levels += result.level;
+        pieces += result.pieces;
+        ticks += double(result.ticks);
+        maxLines = std::max(maxLines, result.lines);
+        maxPoints = std::max(maxPoints, result.points);
+        maxLevel = std::max(maxLevel, result.level);
+        maxPieces = std::max(maxPieces, result.pieces);
+        maxTicks = std::max(maxTicks, result.ticks);
+    }
+
+    printf("Games:             %u\n", options.games);
+    printf("Threads:           %u\n", options.threads);
+    printf("Wall time:         %.3f s\n", seconds);
+    printf("Games per second:  %.1f\n", options.games / seconds);
+    printf("Pieces per second: %.1f\n", pieces / seconds);
+    if (moves)
+        printf("Rollouts per move: %.1f\n", double(rollouts) / moves);
+    if (probes)
+        printf("Table hit rate:    %.1f%%\n", hitRate * 100.0);
+    PrintStat("Lines", lines, maxLines, options.games);
+    PrintStat("Points", points, maxPoints, options.games);
+    PrintStat("Level reached", levels, maxLevel, options.games);
+    PrintStat("Pieces", pieces, maxPieces, options.games);
+    PrintStat("Game ticks", ticks, double(maxTicks), options.games);
+
+    if (options.csvFile && !WriteCsv(options.csvFile, results))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
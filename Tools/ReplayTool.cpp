@@ -0,0 +1,66 @@
+// Plays recorded games headless as fast as possible and checks that they reproduce exactly.
+// Usage: TetrisReplay [--quiet] file...
+
+#include "Game.h"
+#include "Replay.h"
+#include <chrono>
+#include <cstring>
+
+int main(int argc, char** argv)
+{
+    bool quiet = false;
+    uint32 files = 0, failures = 0;
+    uint64 bytes = 0, ticks = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--quiet"))
+        {
+            quiet = true;
+            continue;
+        }
+
+        files++;
+        ReplayPlayer player;
+        if (!player.Load(argv[i]))
+        {
+            printf("%s: not a valid replay\n", argv[i]);
+            failures++;
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point fileStart = std::chrono::steady_clock::now();
+        Game game;
+        bool verified = player.Run(&game);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fileStart).count();
+
+        bytes += player.GetSize();
+        ticks += player.GetEndTick();
+        if (!verified)
+        {
+            failures++;
+            printf("%s: out of sync at tick %llu\n", argv[i], (unsigned long long)player.GetDesyncTick());
+            continue;
+        }
+
+        if (!quiet)
+            printf("%s: ok, seed %llu, %u records, %zu bytes, %.1f s of play, %u points, %u lines, %u pieces, %.3f ms\n",
+                argv[i], (unsigned long long)player.GetSeed(), player.GetRecordCount(), player.GetSize(),
+                double(player.GetEndTick()) / TICKS_PER_SECOND, game.GetPoints(), game.GetLinesCompleted(), game.GetPiecesPlaced(), milliseconds);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!files)
+    {
+        fprintf(stderr, "Usage: TetrisReplay [--quiet] file...\n");
+        return EXIT_FAILURE;
+    }
+
+    double hours = double(ticks) / TICKS_PER_SECOND / 3600.0;
+    printf("Replays:           %u (%u failed)\n", files, failures);
+    printf("Wall time:         %.3f s\n", seconds);
+    printf("Played time:       %.2f h, %.1f KB per hour\n", hours, hours > 0.0 ? bytes / 1024.0 / hours : 0.0);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}